@@ -0,0 +1,82 @@
+#ifndef REFCOUNTEDPTR_BENCHMARK_HEADER
+#define REFCOUNTEDPTR_BENCHMARK_HEADER
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+/**
+ * @brief Checks whether the benchmark was started with --quick.
+ *
+ * Quick runs shrink every workload so that ctest can use the benchmarks as
+ * smoke tests; their timings are not meaningful.
+ *
+ * @param argc Argument count of main.
+ * @param argv Arguments of main.
+ * @return bool True if --quick was given.
+ */
+inline bool benchmark_is_quick(int argc, char **argv) {
+  for (int index = 1; index < argc; ++index) {
+    if (std::strcmp(argv[index], "--quick") == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Keeps the compiler from optimizing away a value or the work that
+ * produced it.
+ *
+ * @tparam T The type of the value.
+ * @param value The value to keep.
+ */
+template <typename T> inline void benchmark_keep(T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r"(&value) : "memory");
+#else
+  static volatile const void *sink;
+  sink = &value;
+#endif
+}
+
+/**
+ * @brief Measures the time of one iteration of a workload.
+ *
+ * The workload runs a number of times and the fastest run is reported, which
+ * filters out scheduling noise.
+ *
+ * @tparam Function Callable running the whole workload once.
+ * @param iterations Number of iterations one call of function performs.
+ * @param function The workload.
+ * @return double Nanoseconds per iteration of the fastest run.
+ */
+template <typename Function>
+double benchmark_nanoseconds(std::size_t iterations, Function function) {
+  double best = std::numeric_limits<double>::max();
+  for (int run = 0; run < 5; ++run) {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count() / static_cast<double>(iterations));
+  }
+  return best;
+}
+
+/**
+ * @brief Prints one result line.
+ *
+ * @param name What was measured.
+ * @param value The measurement.
+ * @param unit Unit of value.
+ */
+inline void benchmark_report(const char *name, double value, const char *unit) {
+  std::printf("%-48s %12.2f %s\n", name, value, unit);
+}
+
+#endif
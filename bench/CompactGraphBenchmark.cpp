@@ -0,0 +1,164 @@
+#include "Benchmark.h"
+#include "CompactRefCountedPtr.h"
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Bytes requested from the global allocator so far.
+ */
+static std::size_t allocated_bytes = 0;
+
+void *operator new(std::size_t size) {
+  allocated_bytes += size;
+  if (void *memory = std::malloc(size == 0 ? 1 : size)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  allocated_bytes += size;
+  std::size_t align = static_cast<std::size_t>(alignment);
+  if (void *memory =
+          std::aligned_alloc(align, (size + align - 1) / align * align)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+
+void operator delete(void *memory, std::align_val_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept {
+  std::free(memory);
+}
+
+/**
+ * @brief Graph node whose edges are four-byte arena pointers.
+ */
+struct CompactNode {
+  int value;                                            ///< Payload.
+  std::vector<CompactRefCountedPtr<CompactNode>> edges; ///< Outgoing edges.
+
+  /**
+   * @brief Constructs a node without edges.
+   *
+   * @param value The payload.
+   */
+  CompactNode(int value) : value(value) {}
+};
+
+/**
+ * @brief Graph node whose edges are ordinary shared pointers.
+ */
+struct WideNode {
+  int value;                                  ///< Payload.
+  std::vector<RefCountedPtr<WideNode>> edges; ///< Outgoing edges.
+
+  /**
+   * @brief Constructs a node without edges.
+   *
+   * @param value The payload.
+   */
+  WideNode(int value) : value(value) {}
+};
+
+/**
+ * @brief Builds an acyclic graph where every node points at earlier nodes.
+ *
+ * @tparam Pointer The pointer type of the nodes.
+ * @param nodes Receives the nodes.
+ * @param count Number of nodes.
+ * @param degree Edges per node.
+ */
+template <typename Pointer>
+static void build_graph(std::vector<Pointer> &nodes, std::size_t count,
+                        std::size_t degree) {
+  std::mt19937 random(42);
+  nodes.reserve(count);
+  for (std::size_t index = 0; index < count; ++index) {
+    Pointer &node = nodes.emplace_back(static_cast<int>(index));
+    if (index > 0) {
+      node.get_data()->edges.reserve(degree);
+      for (std::size_t edge = 0; edge < degree; ++edge) {
+        Pointer target(nodes[random() % index]);
+        node.get_data()->edges.push_back(std::move(target));
+      }
+    }
+  }
+}
+
+/**
+ * @brief Sums the payload of every edge target, visiting nodes in order.
+ *
+ * @tparam Pointer The pointer type of the nodes.
+ * @param nodes The graph.
+ * @return long long The sum.
+ */
+template <typename Pointer>
+static long long traverse(std::vector<Pointer> &nodes) {
+  long long sum = 0;
+  for (Pointer &node : nodes) {
+    for (auto &edge : node.get_data()->edges) {
+      sum += edge.get_data()->value;
+    }
+  }
+  return sum;
+}
+
+/**
+ * @brief Builds the same graph with CompactRefCountedPtr and RefCountedPtr
+ * and compares memory footprint and traversal speed.
+ *
+ * @tparam Pointer The pointer type of the nodes.
+ * @param name Label of the pointer type.
+ * @param count Number of nodes.
+ * @param degree Edges per node.
+ * @param slot_size Bytes per node taken outside the global allocator, such as
+ * an arena slot.
+ */
+template <typename Pointer>
+static void measure(const char *name, std::size_t count, std::size_t degree,
+                    std::size_t slot_size) {
+  std::vector<Pointer> nodes;
+  std::size_t before = allocated_bytes;
+  build_graph(nodes, count, degree);
+  double bytes =
+      static_cast<double>(allocated_bytes - before + count * slot_size);
+  long long sum = 0;
+  double time = benchmark_nanoseconds(count * degree, [&] {
+    sum += traverse(nodes);
+    benchmark_keep(sum);
+  });
+  std::printf("%s\n", name);
+  benchmark_report("  allocated per node", bytes / count, "bytes");
+  benchmark_report("  pointer size", sizeof(Pointer), "bytes");
+  benchmark_report("  traversal, per edge", time, "ns");
+}
+
+/**
+ * @brief Compares a dense object graph held by CompactRefCountedPtr with the
+ * same graph held by RefCountedPtr.
+ *
+ * @param argc Argument count.
+ * @param argv Arguments; --quick shrinks the workload.
+ * @return int Exit status.
+ */
+int main(int argc, char **argv) {
+  std::size_t count = benchmark_is_quick(argc, argv) ? 1000 : 500000;
+  std::size_t degree = 8;
+  std::printf("%zu nodes, %zu edges each\n", count, degree);
+  measure<CompactRefCountedPtr<CompactNode>>(
+      "CompactRefCountedPtr", count, degree,
+      RefCountedArena<CompactNode>::get_slot_size());
+  measure<RefCountedPtr<WideNode>>("RefCountedPtr", count, degree, 0);
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include "Benchmark.h"
+#include "RefCountedPtr.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Copies and releases one pointer per thread, all threads at once.
+ *
+ * Every thread only touches its own object, so any slowdown compared with a
+ * single thread comes from counters sharing a cache line.
+ *
+ * @param pointers One pointer per thread.
+ * @param copies Copies each thread makes.
+ */
+static void copy_concurrently(std::vector<RefCountedPtr<int>> &pointers,
+                              std::size_t copies) {
+  std::vector<std::thread> threads;
+  for (RefCountedPtr<int> &pointer : pointers) {
+    threads.emplace_back([&pointer, copies] {
+      for (std::size_t copy = 0; copy < copies; ++copy) {
+        RefCountedPtr<int> local(pointer);
+        benchmark_keep(local);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+/**
+ * @brief Measures per-thread copies of adjacent packed blocks against
+ * cache-line isolated blocks.
+ *
+ * The objects are allocated back to back, so packed blocks typically share
+ * cache lines. The difference only shows on a machine with several cores.
+ *
+ * @param argc Argument count.
+ * @param argv Arguments; --quick shrinks the workload.
+ * @return int Exit status.
+ */
+int main(int argc, char **argv) {
+  std::size_t copies = benchmark_is_quick(argc, argv) ? 1000 : 2000000;
+  std::size_t thread_count = std::clamp<std::size_t>(
+      std::thread::hardware_concurrency(), 2, 8);
+  std::vector<RefCountedPtr<int>> packed;
+  std::vector<RefCountedPtr<int>> isolated;
+  for (std::size_t index = 0; index < thread_count; ++index) {
+    packed.emplace_back(ref_counted_packed, 0);
+  }
+  for (std::size_t index = 0; index < thread_count; ++index) {
+    isolated.emplace_back(ref_counted_isolated, 0);
+  }
+  std::printf("%zu threads, %zu copies each\n", thread_count, copies);
+  double packed_time = benchmark_nanoseconds(
+      copies, [&] { copy_concurrently(packed, copies); });
+  double isolated_time = benchmark_nanoseconds(
+      copies, [&] { copy_concurrently(isolated, copies); });
+  benchmark_report("packed blocks, per copy", packed_time, "ns");
+  benchmark_report("isolated blocks, per copy", isolated_time, "ns");
+  return 0;
+}
@@ -0,0 +1,196 @@
+#include "Benchmark.h"
+#include "RefCountedPtr.h"
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Calls of the global allocator so far.
+ */
+static std::size_t allocations = 0;
+
+/**
+ * @brief Bytes requested from the global allocator so far.
+ */
+static std::size_t allocated_bytes = 0;
+
+void *operator new(std::size_t size) {
+  ++allocations;
+  allocated_bytes += size;
+  if (void *memory = std::malloc(size == 0 ? 1 : size)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  ++allocations;
+  allocated_bytes += size;
+  std::size_t align = static_cast<std::size_t>(alignment);
+  if (void *memory =
+          std::aligned_alloc(align, (size + align - 1) / align * align)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+
+void operator delete(void *memory, std::align_val_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept {
+  std::free(memory);
+}
+
+/**
+ * @brief Message flowing through the workloads.
+ */
+struct Message {
+  int id;        ///< Payload.
+  char body[56]; ///< Payload.
+
+  /**
+   * @brief Constructs a message.
+   *
+   * @param id The payload.
+   */
+  Message(int id) : id(id), body() {}
+};
+
+/**
+ * @brief Hands every message to a single consumer that drops it, as in a
+ * parse-and-process pipeline where nothing is ever shared.
+ *
+ * @tparam Make Callable creating a RefCountedPtr<Message>.
+ * @param make The construction under test.
+ * @param count Number of messages.
+ */
+template <typename Make> static void pipeline(Make make, int count) {
+  for (int id = 0; id < count; ++id) {
+    RefCountedPtr<Message> message = make(id);
+    RefCountedPtr<Message> consumed(std::move(message));
+    benchmark_keep(consumed);
+  }
+}
+
+/**
+ * @brief Stores every message in a cache and lets a reader copy one in ten.
+ *
+ * @tparam Make Callable creating a RefCountedPtr<Message>.
+ * @param make The construction under test.
+ * @param count Number of messages.
+ */
+template <typename Make> static void cache(Make make, int count) {
+  std::vector<RefCountedPtr<Message>> entries;
+  std::vector<RefCountedPtr<Message>> read;
+  entries.reserve(count);
+  read.reserve(count / 10 + 1);
+  for (int id = 0; id < count; ++id) {
+    entries.push_back(make(id));
+  }
+  for (int id = 0; id < count; id += 10) {
+    read.emplace_back(entries[id]);
+  }
+}
+
+/**
+ * @brief Publishes every message to three subscribers.
+ *
+ * @tparam Make Callable creating a RefCountedPtr<Message>.
+ * @param make The construction under test.
+ * @param count Number of messages.
+ */
+template <typename Make> static void fan_out(Make make, int count) {
+  std::vector<RefCountedPtr<Message>> subscribers[3];
+  for (std::vector<RefCountedPtr<Message>> &subscriber : subscribers) {
+    subscriber.reserve(count);
+  }
+  for (int id = 0; id < count; ++id) {
+    RefCountedPtr<Message> message = make(id);
+    for (std::vector<RefCountedPtr<Message>> &subscriber : subscribers) {
+      subscriber.emplace_back(message);
+    }
+  }
+}
+
+/**
+ * @brief Runs a workload with one construction and reports allocations per
+ * message.
+ *
+ * @tparam Workload Callable running the workload with a construction.
+ * @param name Label of the construction.
+ * @param workload The workload.
+ * @param count Number of messages.
+ */
+template <typename Workload>
+static void report(const char *name, Workload workload, int count) {
+  std::size_t calls_before = allocations;
+  std::size_t bytes_before = allocated_bytes;
+  workload(count);
+  double calls = static_cast<double>(allocations - calls_before);
+  double bytes = static_cast<double>(allocated_bytes - bytes_before);
+  std::printf("  %s\n", name);
+  benchmark_report("    allocations per message", calls / count, "");
+  benchmark_report("    bytes per message", bytes / count, "bytes");
+}
+
+/**
+ * @brief Runs one workload with eager, lazy and in-place construction.
+ *
+ * The containers reserve their storage up front; the reported numbers
+ * include that storage, which is the same for every construction.
+ *
+ * @tparam Run Callable running the workload with a construction and a count.
+ * @param title Label of the workload.
+ * @param run The workload.
+ * @param count Number of messages.
+ */
+template <typename Run>
+static void compare(const char *title, Run run, int count) {
+  std::printf("%s\n", title);
+  report("eager: RefCountedPtr<T>(new T)",
+         [&](int count) {
+           run([](int id) { return RefCountedPtr<Message>(new Message(id)); },
+               count);
+         },
+         count);
+  report("lazy: RefCountedPtr<T>(ref_counted_lazy, new T)",
+         [&](int count) {
+           run(
+               [](int id) {
+                 return RefCountedPtr<Message>(ref_counted_lazy,
+                                               new Message(id));
+               },
+               count);
+         },
+         count);
+  report("in place: RefCountedPtr<T>(args...)",
+         [&](int count) {
+           run([](int id) { return RefCountedPtr<Message>(id); }, count);
+         },
+         count);
+}
+
+/**
+ * @brief Counts calls to operator new for eager and lazy control blocks in
+ * three workloads with different sharing patterns.
+ *
+ * @param argc Argument count.
+ * @param argv Arguments; --quick shrinks the workload.
+ * @return int Exit status.
+ */
+int main(int argc, char **argv) {
+  int count = benchmark_is_quick(argc, argv) ? 1000 : 100000;
+  compare("pipeline (never shared)",
+          [](auto make, int count) { pipeline(make, count); }, count);
+  compare("cache (one in ten shared)",
+          [](auto make, int count) { cache(make, count); }, count);
+  compare("fan-out (always shared)",
+          [](auto make, int count) { fan_out(make, count); }, count);
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include "Benchmark.h"
+#include "RefCountedPtr.h"
+#include "RefCountedVector.h"
+#include <vector>
+
+/**
+ * @brief Number of elements kept in the vectors of the erase workload.
+ */
+static constexpr std::size_t erase_size = 1024;
+
+/**
+ * @brief Measures growing a vector of RefCountedPtr and erasing from its
+ * middle, RefCountedVector against std::vector.
+ *
+ * std::vector moves every element into the new storage on growth, and
+ * shifts the tail one move assignment at a time on erase; RefCountedVector
+ * relocates both with a single memmove.
+ *
+ * @param argc Argument count.
+ * @param argv Arguments; --quick shrinks the workload.
+ * @return int Exit status.
+ */
+int main(int argc, char **argv) {
+  std::size_t count = benchmark_is_quick(argc, argv) ? 1000 : 1000000;
+  RefCountedPtr<int> shared(0);
+
+  double std_growth = benchmark_nanoseconds(count, [&] {
+    std::vector<RefCountedPtr<int>> pointers;
+    for (std::size_t index = 0; index < count; ++index) {
+      pointers.emplace_back(shared);
+    }
+    benchmark_keep(pointers);
+  });
+  double relocating_growth = benchmark_nanoseconds(count, [&] {
+    RefCountedVector<RefCountedPtr<int>> pointers;
+    for (std::size_t index = 0; index < count; ++index) {
+      pointers.emplace_back(shared);
+    }
+    benchmark_keep(pointers);
+  });
+
+  std::size_t erasures = count / 10;
+  std::vector<RefCountedPtr<int>> plain;
+  RefCountedVector<RefCountedPtr<int>> relocating;
+  for (std::size_t index = 0; index < erase_size; ++index) {
+    plain.emplace_back(shared);
+    relocating.emplace_back(shared);
+  }
+  double std_erase = benchmark_nanoseconds(erasures, [&] {
+    for (std::size_t index = 0; index < erasures; ++index) {
+      plain.erase(plain.begin() + erase_size / 2);
+      plain.emplace_back(shared);
+    }
+    benchmark_keep(plain);
+  });
+  double relocating_erase = benchmark_nanoseconds(erasures, [&] {
+    for (std::size_t index = 0; index < erasures; ++index) {
+      relocating.erase(erase_size / 2);
+      relocating.emplace_back(shared);
+    }
+    benchmark_keep(relocating);
+  });
+
+  std::printf("vector of RefCountedPtr<int>\n");
+  benchmark_report("  std::vector growth, per element", std_growth, "ns");
+  benchmark_report("  RefCountedVector growth, per element",
+                   relocating_growth, "ns");
+  benchmark_report("  std::vector erase in the middle", std_erase, "ns");
+  benchmark_report("  RefCountedVector erase in the middle", relocating_erase,
+                   "ns");
+  return 0;
+}
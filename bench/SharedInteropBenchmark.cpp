@@ -0,0 +1,115 @@
+#include "Benchmark.h"
+#include "RefCountedPtr.h"
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+/**
+ * @brief Calls of the global allocator so far.
+ */
+static std::size_t allocations = 0;
+
+void *operator new(std::size_t size) {
+  ++allocations;
+  if (void *memory = std::malloc(size == 0 ? 1 : size)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  ++allocations;
+  std::size_t align = static_cast<std::size_t>(alignment);
+  if (void *memory =
+          std::aligned_alloc(align, (size + align - 1) / align * align)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+
+void operator delete(void *memory, std::align_val_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept {
+  std::free(memory);
+}
+
+/**
+ * @brief Runs a workload once to count its allocations, then times it, and
+ * reports both per iteration.
+ *
+ * @tparam Workload Callable running all iterations once.
+ * @param name Label of the workload.
+ * @param count Number of iterations one call of workload performs.
+ * @param workload The workload.
+ */
+template <typename Workload>
+static void report(const char *name, std::size_t count, Workload workload) {
+  std::size_t before = allocations;
+  workload();
+  double calls = static_cast<double>(allocations - before);
+  double time = benchmark_nanoseconds(count, workload);
+  std::printf("%s\n", name);
+  benchmark_report("  allocations per iteration", calls / count, "");
+  benchmark_report("  time per iteration", time, "ns");
+}
+
+/**
+ * @brief Measures RefCountedPtr::to_shared for objects with and without a
+ * control block, against copying a std::shared_ptr.
+ *
+ * A lazily owned object is converted through one fused bridge block, and
+ * later conversions reuse its owner; an object that already has a control
+ * block pays one std::shared_ptr control block per conversion.
+ *
+ * @param argc Argument count.
+ * @param argv Arguments; --quick shrinks the workload.
+ * @return int Exit status.
+ */
+int main(int argc, char **argv) {
+  std::size_t count = benchmark_is_quick(argc, argv) ? 1000 : 200000;
+
+  report("lazy object: new + first to_shared", count, [&] {
+    for (std::size_t index = 0; index < count; ++index) {
+      RefCountedPtr<int> pointer(ref_counted_lazy, new int(0));
+      std::shared_ptr<int> shared = pointer.to_shared();
+      benchmark_keep(shared);
+    }
+  });
+  report("lazy object: new + copy + first to_shared", count, [&] {
+    for (std::size_t index = 0; index < count; ++index) {
+      RefCountedPtr<int> pointer(ref_counted_lazy, new int(0));
+      RefCountedPtr<int> copy(pointer);
+      std::shared_ptr<int> shared = copy.to_shared();
+      benchmark_keep(shared);
+    }
+  });
+
+  RefCountedPtr<int> bridged(ref_counted_lazy, new int(0));
+  std::shared_ptr<int> first = bridged.to_shared();
+  report("bridged object: repeated to_shared", count, [&] {
+    for (std::size_t index = 0; index < count; ++index) {
+      std::shared_ptr<int> shared = bridged.to_shared();
+      benchmark_keep(shared);
+    }
+  });
+  RefCountedPtr<int> packed(ref_counted_packed, 0);
+  report("packed object: repeated to_shared", count, [&] {
+    for (std::size_t index = 0; index < count; ++index) {
+      std::shared_ptr<int> shared = packed.to_shared();
+      benchmark_keep(shared);
+    }
+  });
+  report("std::shared_ptr copy", count, [&] {
+    for (std::size_t index = 0; index < count; ++index) {
+      std::shared_ptr<int> shared = first;
+      benchmark_keep(shared);
+    }
+  });
+  return 0;
+}
@@ -0,0 +1,106 @@
+#include "Benchmark.h"
+#include "RefCountedPtr.h"
+#include <cstdio>
+#include <utility>
+
+/**
+ * @brief Number of calls in each chain.
+ */
+static constexpr int chain_depth = 16;
+
+/**
+ * @brief Passes a pointer down a chain of calls by value.
+ *
+ * Each level moves the pointer into the next call, so no reference count is
+ * touched and only the calling convention is measured.
+ *
+ * @tparam Depth Remaining calls.
+ * @param pointer The pointer to pass on.
+ * @return int The value reached at the end of the chain.
+ */
+template <int Depth>
+[[gnu::noinline]] int pass_pointer(RefCountedPtr<int> pointer) {
+  if constexpr (Depth == 0) {
+    return *pointer.get_data();
+  } else {
+    return pass_pointer<Depth - 1>(std::move(pointer)) + 1;
+  }
+}
+
+/**
+ * @brief Passes a handle down a chain of calls by value.
+ *
+ * @tparam Depth Remaining calls.
+ * @param handle The handle to pass on.
+ * @return int The value reached at the end of the chain.
+ */
+template <int Depth>
+[[gnu::noinline]] int pass_handle(RefCountedHandle<int> handle) {
+  if constexpr (Depth == 0) {
+    return *handle.get_data();
+  } else {
+    return pass_handle<Depth - 1>(std::move(handle)) + 1;
+  }
+}
+
+/**
+ * @brief Passes a raw pointer down a chain of calls, as the baseline.
+ *
+ * @tparam Depth Remaining calls.
+ * @param data The pointer to pass on.
+ * @return int The value reached at the end of the chain.
+ */
+template <int Depth> [[gnu::noinline]] int pass_raw(int *data) {
+  if constexpr (Depth == 0) {
+    return *data;
+  } else {
+    return pass_raw<Depth - 1>(data) + 1;
+  }
+}
+
+/**
+ * @brief Measures a call chain passing handles by value, with and without
+ * [[clang::trivial_abi]] depending on the build.
+ *
+ * Build once with -DREFCOUNTEDPTR_ENABLE_TRIVIAL_ABI=ON and once without
+ * under Clang to compare; other compilers ignore the attribute.
+ *
+ * @param argc Argument count.
+ * @param argv Arguments; --quick shrinks the workload.
+ * @return int Exit status.
+ */
+int main(int argc, char **argv) {
+  std::size_t chains = benchmark_is_quick(argc, argv) ? 1000 : 2000000;
+#if defined(REFCOUNTEDPTR_ENABLE_TRIVIAL_ABI) && defined(__clang__)
+  std::printf("handles passed with [[clang::trivial_abi]]\n");
+#else
+  std::printf("handles passed with the default calling convention\n");
+#endif
+  RefCountedPtr<int> pointer(1);
+  RefCountedHandle<int> handle(1);
+  int value = 0;
+  double raw = benchmark_nanoseconds(chains * chain_depth, [&] {
+    for (std::size_t chain = 0; chain < chains; ++chain) {
+      value += pass_raw<chain_depth>(pointer.get_data());
+      benchmark_keep(value);
+    }
+  });
+  double pointers = benchmark_nanoseconds(chains * chain_depth, [&] {
+    for (std::size_t chain = 0; chain < chains; ++chain) {
+      value += pass_pointer<chain_depth>(std::move(pointer));
+      pointer = RefCountedPtr<int>(1);
+      benchmark_keep(value);
+    }
+  });
+  double handles = benchmark_nanoseconds(chains * chain_depth, [&] {
+    for (std::size_t chain = 0; chain < chains; ++chain) {
+      value += pass_handle<chain_depth>(std::move(handle));
+      handle = RefCountedHandle<int>(1);
+      benchmark_keep(value);
+    }
+  });
+  benchmark_report("raw pointer, per call", raw, "ns");
+  benchmark_report("RefCountedPtr by value, per call", pointers, "ns");
+  benchmark_report("RefCountedHandle by value, per call", handles, "ns");
+  return 0;
+}
@@ -0,0 +1,268 @@
+#ifndef COMPACTREFCOUNTEDPTR_HEADER
+#define COMPACTREFCOUNTEDPTR_HEADER
+
+#include "RefCountedPtr.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Fixed-capacity arena holding reference-counted objects in one
+ * contiguous range of slots.
+ *
+ * Each slot stores a reference count next to the object, and slots are
+ * addressed by a 32-bit index, so a CompactRefCountedPtr into the arena is four
+ * bytes and decompresses to a raw pointer with a single scaled add from the
+ * arena base. The whole index range is reserved as address space on first
+ * use, and memory is committed in chunks as the arena fills up, so objects
+ * never move and the capacity only bounds the address space reserved.
+ * Nothing is reserved before first use, which keeps the constructor constexpr
+ * and lets arenas be declared as globals without static-initialization-order
+ * concerns. Every pointer into the arena must be released before the arena
+ * itself is destroyed.
+ *
+ * @tparam T The type of the managed objects.
+ * @tparam Counter The reference count policy of each slot.
+ */
+template <typename T, typename Counter = RefCountedCounter<std::uint32_t>>
+class RefCountedArena {
+private:
+  /**
+   * @brief Storage for one object and its reference count.
+   */
+  struct Slot {
+    std::atomic<typename Counter::value_type>
+        shared_references; ///< The shared reference count.
+    alignas(T) unsigned char storage[sizeof(T)]; ///< Storage for the object.
+  };
+
+  /**
+   * @brief Number of bytes committed at a time; a multiple of the page size
+   * and of the allocation granularity of every supported platform.
+   */
+  static constexpr std::size_t commit_granularity = std::size_t(1) << 16;
+
+  Slot *slots;                            ///< Reserved range, null until used.
+  std::size_t committed;                  ///< Bytes of the range committed.
+  std::uint32_t capacity;                 ///< Maximum number of slots.
+  std::uint32_t used;                     ///< Slots handed out at least once.
+  std::vector<std::uint32_t> free_slots;  ///< Released slots ready for reuse.
+  std::mutex mutex;                       ///< Guards allocation and reuse.
+
+  /**
+   * @brief Retrieves the number of bytes of address space reserved for the
+   * slots.
+   *
+   * @return std::size_t Size of the capacity in slots, rounded up to
+   * commit_granularity.
+   */
+  std::size_t get_reserved_size();
+
+  /**
+   * @brief Reserves address space without committing memory to it.
+   *
+   * @param size Number of bytes, a multiple of commit_granularity.
+   * @return void* Start of the range, or nullptr if it could not be reserved.
+   */
+  static void *reserve_range(std::size_t);
+
+  /**
+   * @brief Commits memory to part of a reserved range.
+   *
+   * @param start Start of the part, aligned to commit_granularity.
+   * @param size Number of bytes, a multiple of commit_granularity.
+   * @return bool True on success.
+   */
+  static bool commit_range(void *, std::size_t);
+
+  /**
+   * @brief Returns a reserved range and its committed memory to the system.
+   *
+   * @param start Start of the range.
+   * @param size Number of bytes reserved.
+   */
+  static void release_range(void *, std::size_t);
+
+  /**
+   * @brief Finds the slot with the given index.
+   *
+   * @param index Index of a slot handed out before.
+   * @return Slot* The slot.
+   */
+  Slot *get_slot(std::uint32_t);
+
+public:
+  /**
+   * @brief Index value used by empty pointers.
+   */
+  static constexpr std::uint32_t null_index =
+      std::numeric_limits<std::uint32_t>::max();
+
+  /**
+   * @brief Arena used by CompactRefCountedPtr when none is specified.
+   */
+  static RefCountedArena<T, Counter> default_arena;
+
+  /**
+   * @brief Constructs an empty arena with room for the given number of
+   * objects, without allocating.
+   *
+   * @param capacity Maximum number of live objects, below null_index.
+   */
+  constexpr explicit RefCountedArena(std::uint32_t capacity = 1u << 20)
+      : slots(nullptr), committed(0), capacity(capacity), used(0) {}
+
+  RefCountedArena(const RefCountedArena<T, Counter> &) = delete;
+  RefCountedArena<T, Counter> &
+  operator=(const RefCountedArena<T, Counter> &) = delete;
+
+  /**
+   * @brief Destroys any objects still alive and releases the slot range.
+   */
+  ~RefCountedArena();
+
+  /**
+   * @brief Constructs a new object in a free slot.
+   *
+   * Throws std::bad_alloc when every slot is in use, or when the address
+   * space cannot be reserved or memory cannot be committed.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param args Arguments to pass to the T constructor.
+   * @return std::uint32_t Index of the slot, with a reference count of zero.
+   */
+  template <typename... Args> std::uint32_t create(Args &&...);
+
+  /**
+   * @brief Decompresses an index into a pointer to its object.
+   *
+   * @param index Index of a live slot.
+   * @return T* Pointer to the object in that slot.
+   */
+  T *get_data(std::uint32_t);
+
+  /**
+   * @brief Adds a reference to the object in a slot.
+   *
+   * @param index Index of a live slot.
+   */
+  void add_reference(std::uint32_t);
+
+  /**
+   * @brief Removes a reference, destroying the object and recycling its slot
+   * when it was the last one.
+   *
+   * @param index Index of a live slot.
+   */
+  void release_reference(std::uint32_t);
+
+  /**
+   * @brief Retrieves the number of bytes occupied by each slot.
+   *
+   * @return std::size_t Bytes per object, including its reference count.
+   */
+  static constexpr std::size_t get_slot_size() { return sizeof(Slot); }
+};
+
+/**
+ * @brief Four-byte shared pointer into a RefCountedArena.
+ *
+ * Stores a 32-bit slot index instead of a pointer pair, for dense object
+ * graphs where handle size dominates memory. Dereferencing scales the index
+ * by the slot size and adds it to the arena base.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Arena The arena the object lives in; must have static storage
+ * duration.
+ */
+template <typename T, auto &Arena = RefCountedArena<T>::default_arena>
+class REFCOUNTEDPTR_TRIVIALLY_RELOCATABLE REFCOUNTEDPTR_TRIVIAL_ABI
+    CompactRefCountedPtr {
+private:
+  std::uint32_t index; ///< Slot index of the managed object.
+
+  /**
+   * @brief Drops this pointer's reference, if any.
+   */
+  void release_reference();
+
+public:
+  /**
+   * @brief Default constructor creating an empty CompactRefCountedPtr.
+   */
+  CompactRefCountedPtr() : index(Arena.null_index) {}
+
+  /**
+   * @brief Constructs a CompactRefCountedPtr with variadic arguments.
+   *
+   * Creates a new object of T inside the arena and sets the reference count
+   * to 1.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param args Arguments to pass to the T constructor.
+   */
+  template <typename... Args>
+    requires(!ref_counted_is_self<CompactRefCountedPtr<T, Arena>, Args...>)
+  CompactRefCountedPtr(Args &&...args);
+
+  /**
+   * @brief Copy constructor for sharing ownership.
+   *
+   * @param other The CompactRefCountedPtr to share ownership with.
+   */
+  CompactRefCountedPtr(CompactRefCountedPtr<T, Arena> &);
+
+  /**
+   * @brief Move constructor transferring ownership without touching the count.
+   *
+   * @param other The CompactRefCountedPtr to take ownership from; left empty.
+   */
+  CompactRefCountedPtr(CompactRefCountedPtr<T, Arena> &&) noexcept;
+
+  /**
+   * @brief Destructor that releases the object when no references remain.
+   */
+  ~CompactRefCountedPtr();
+
+  /**
+   * @brief Retrieves the raw pointer to the managed object.
+   *
+   * @return T* The managed object, or nullptr if the pointer is empty.
+   */
+  T *get_data();
+
+  /**
+   * @brief Assignment operator for sharing ownership.
+   *
+   * @param other The CompactRefCountedPtr to assign from.
+   * @return CompactRefCountedPtr<T, Arena>& Reference to this pointer.
+   */
+  CompactRefCountedPtr<T, Arena> &operator=(CompactRefCountedPtr<T, Arena> &);
+
+  /**
+   * @brief Move assignment operator transferring ownership.
+   *
+   * @param other The CompactRefCountedPtr to take ownership from; left empty.
+   * @return CompactRefCountedPtr<T, Arena>& Reference to this pointer.
+   */
+  CompactRefCountedPtr<T, Arena> &
+  operator=(CompactRefCountedPtr<T, Arena> &&) noexcept;
+};
+
+/**
+ * @brief CompactRefCountedPtr only holds an index, so it can be relocated with
+ * a memory copy.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Arena The arena the object lives in.
+ */
+template <typename T, auto &Arena>
+struct ref_counted_is_trivially_relocatable<CompactRefCountedPtr<T, Arena>>
+    : std::true_type {};
+
+#include "CompactRefCountedPtr.tpp"
+
+#endif
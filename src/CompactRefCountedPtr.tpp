@@ -0,0 +1,356 @@
+#include "CompactRefCountedPtr.h"
+#include <memory>
+#include <new>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+/**
+ * @brief Arena used by CompactRefCountedPtr when none is specified.
+ *
+ * @tparam T The type of the managed objects.
+ * @tparam Counter The reference count policy of each slot.
+ */
+template <typename T, typename Counter>
+RefCountedArena<T, Counter> RefCountedArena<T, Counter>::default_arena;
+
+/**
+ * @brief Destroys any objects still alive and releases the slot range.
+ *
+ * Objects still referenced at this point are destroyed so that their
+ * resources are not leaked; the pointers to them must not be used again.
+ *
+ * @tparam T The type of the managed objects.
+ * @tparam Counter The reference count policy of each slot.
+ */
+template <typename T, typename Counter>
+RefCountedArena<T, Counter>::~RefCountedArena() {
+  if (slots == nullptr) {
+    return;
+  }
+  std::vector<bool> released(used, false);
+  for (std::uint32_t index : free_slots) {
+    released[index] = true;
+  }
+  for (std::uint32_t index = 0; index < used; ++index) {
+    if (!released[index]) {
+      std::destroy_at(get_data(index));
+    }
+  }
+  release_range(slots, get_reserved_size());
+}
+
+/**
+ * @brief Retrieves the number of bytes of address space reserved for the
+ * slots.
+ *
+ * @tparam T The type of the managed objects.
+ * @tparam Counter The reference count policy of each slot.
+ * @return std::size_t Size of the capacity in slots, rounded up to
+ * commit_granularity.
+ */
+template <typename T, typename Counter>
+std::size_t RefCountedArena<T, Counter>::get_reserved_size() {
+  std::size_t size = std::size_t(capacity) * sizeof(Slot);
+  return (size + commit_granularity - 1) / commit_granularity *
+         commit_granularity;
+}
+
+/**
+ * @brief Reserves address space without committing memory to it.
+ *
+ * @tparam T The type of the managed objects.
+ * @tparam Counter The reference count policy of each slot.
+ * @param size Number of bytes, a multiple of commit_granularity.
+ * @return void* Start of the range, or nullptr if it could not be reserved.
+ */
+template <typename T, typename Counter>
+void *RefCountedArena<T, Counter>::reserve_range(std::size_t size) {
+#if defined(_WIN32)
+  return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+  void *start = mmap(nullptr, size, PROT_NONE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return start == MAP_FAILED ? nullptr : start;
+#endif
+}
+
+/**
+ * @brief Commits memory to part of a reserved range.
+ *
+ * @tparam T The type of the managed objects.
+ * @tparam Counter The reference count policy of each slot.
+ * @param start Start of the part, aligned to commit_granularity.
+ * @param size Number of bytes, a multiple of commit_granularity.
+ * @return bool True on success.
+ */
+template <typename T, typename Counter>
+bool RefCountedArena<T, Counter>::commit_range(void *start, std::size_t size) {
+#if defined(_WIN32)
+  return VirtualAlloc(start, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+  return mprotect(start, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+/**
+ * @brief Returns a reserved range and its committed memory to the system.
+ *
+ * @tparam T The type of the managed objects.
+ * @tparam Counter The reference count policy of each slot.
+ * @param start Start of the range.
+ * @param size Number of bytes reserved.
+ */
+template <typename T, typename Counter>
+void RefCountedArena<T, Counter>::release_range(void *start,
+                                                std::size_t size) {
+#if defined(_WIN32)
+  static_cast<void>(size);
+  VirtualFree(start, 0, MEM_RELEASE);
+#else
+  munmap(start, size);
+#endif
+}
+
+/**
+ * @brief Constructs a new object in a free slot.
+ *
+ * Reuses a released slot when one is available, otherwise hands out the next
+ * never-used slot, committing the next chunk of the range when the slot
+ * reaches past the committed part. The range is reserved on the first call.
+ *
+ * @tparam T The type of the managed objects.
+ * @tparam Counter The reference count policy of each slot.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param args Arguments forwarded to the T constructor.
+ * @return std::uint32_t Index of the slot, with a reference count of zero.
+ */
+template <typename T, typename Counter>
+template <typename... Args>
+std::uint32_t RefCountedArena<T, Counter>::create(Args &&...args) {
+  std::uint32_t index;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!free_slots.empty()) {
+      index = free_slots.back();
+      free_slots.pop_back();
+    } else if (used < capacity && used != null_index) {
+      if (slots == nullptr) {
+        slots = static_cast<Slot *>(reserve_range(get_reserved_size()));
+        if (slots == nullptr) {
+          throw std::bad_alloc();
+        }
+      }
+      std::size_t end = (std::size_t(used) + 1) * sizeof(Slot);
+      while (committed < end) {
+        if (!commit_range(reinterpret_cast<unsigned char *>(slots) + committed,
+                          commit_granularity)) {
+          throw std::bad_alloc();
+        }
+        committed += commit_granularity;
+      }
+      index = used++;
+    } else {
+      throw std::bad_alloc();
+    }
+  }
+
+  Slot *slot = get_slot(index);
+  try {
+    ::new (static_cast<void *>(slot->storage)) T(std::forward<Args>(args)...);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex);
+    free_slots.push_back(index);
+    throw;
+  }
+  ::new (static_cast<void *>(&slot->shared_references))
+      std::atomic<typename Counter::value_type>(0);
+  return index;
+}
+
+/**
+ * @brief Finds the slot with the given index.
+ *
+ * The slots never move, so this is the arena base plus the scaled index.
+ *
+ * @tparam T The type of the managed objects.
+ * @tparam Counter The reference count policy of each slot.
+ * @param index Index of a slot handed out before.
+ * @return Slot* The slot.
+ */
+template <typename T, typename Counter>
+typename RefCountedArena<T, Counter>::Slot *
+RefCountedArena<T, Counter>::get_slot(std::uint32_t index) {
+  return slots + index;
+}
+
+/**
+ * @brief Decompresses an index into a pointer to its object.
+ *
+ * @tparam T The type of the managed objects.
+ * @tparam Counter The reference count policy of each slot.
+ * @param index Index of a live slot.
+ * @return T* Pointer to the object in that slot.
+ */
+template <typename T, typename Counter>
+T *RefCountedArena<T, Counter>::get_data(std::uint32_t index) {
+  return std::launder(reinterpret_cast<T *>(get_slot(index)->storage));
+}
+
+/**
+ * @brief Adds a reference to the object in a slot.
+ *
+ * @tparam T The type of the managed objects.
+ * @tparam Counter The reference count policy of each slot.
+ * @param index Index of a live slot.
+ */
+template <typename T, typename Counter>
+void RefCountedArena<T, Counter>::add_reference(std::uint32_t index) {
+  Counter::increment(get_slot(index)->shared_references);
+}
+
+/**
+ * @brief Removes a reference, destroying the object and recycling its slot
+ * when it was the last one.
+ *
+ * @tparam T The type of the managed objects.
+ * @tparam Counter The reference count policy of each slot.
+ * @param index Index of a live slot.
+ */
+template <typename T, typename Counter>
+void RefCountedArena<T, Counter>::release_reference(std::uint32_t index) {
+  if (Counter::decrement(get_slot(index)->shared_references)) {
+    std::destroy_at(get_data(index));
+    std::lock_guard<std::mutex> lock(mutex);
+    free_slots.push_back(index);
+  }
+}
+
+/**
+ * @brief Drops this pointer's reference, if any.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Arena The arena the object lives in.
+ */
+template <typename T, auto &Arena>
+void CompactRefCountedPtr<T, Arena>::release_reference() {
+  if (index != Arena.null_index) {
+    Arena.release_reference(index);
+  }
+}
+
+/**
+ * @brief Constructs a CompactRefCountedPtr with variadic arguments.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Arena The arena the object lives in.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param args Arguments forwarded to the T constructor.
+ */
+template <typename T, auto &Arena>
+template <typename... Args>
+  requires(!ref_counted_is_self<CompactRefCountedPtr<T, Arena>, Args...>)
+CompactRefCountedPtr<T, Arena>::CompactRefCountedPtr(Args &&...args)
+    : index(Arena.create(std::forward<Args>(args)...)) {
+  Arena.add_reference(index);
+}
+
+/**
+ * @brief Copy constructor for sharing ownership.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Arena The arena the object lives in.
+ * @param other The CompactRefCountedPtr to share ownership with.
+ */
+template <typename T, auto &Arena>
+CompactRefCountedPtr<T, Arena>::CompactRefCountedPtr(
+    CompactRefCountedPtr<T, Arena> &other)
+    : index(other.index) {
+  if (index != Arena.null_index) {
+    Arena.add_reference(index);
+  }
+}
+
+/**
+ * @brief Move constructor transferring ownership without touching the count.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Arena The arena the object lives in.
+ * @param other The CompactRefCountedPtr to take ownership from; left empty.
+ */
+template <typename T, auto &Arena>
+CompactRefCountedPtr<T, Arena>::CompactRefCountedPtr(
+    CompactRefCountedPtr<T, Arena> &&other) noexcept
+    : index(other.index) {
+  other.index = Arena.null_index;
+}
+
+/**
+ * @brief Destructor that releases the object when no references remain.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Arena The arena the object lives in.
+ */
+template <typename T, auto &Arena>
+CompactRefCountedPtr<T, Arena>::~CompactRefCountedPtr() {
+  release_reference();
+}
+
+/**
+ * @brief Retrieves the raw pointer to the managed object.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Arena The arena the object lives in.
+ * @return T* The managed object, or nullptr if the pointer is empty.
+ */
+template <typename T, auto &Arena>
+T *CompactRefCountedPtr<T, Arena>::get_data() {
+  return index != Arena.null_index ? Arena.get_data(index) : nullptr;
+}
+
+/**
+ * @brief Assignment operator for sharing ownership.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Arena The arena the object lives in.
+ * @param other The CompactRefCountedPtr to assign from.
+ * @return CompactRefCountedPtr<T, Arena>& Reference to this pointer.
+ */
+template <typename T, auto &Arena>
+CompactRefCountedPtr<T, Arena> &CompactRefCountedPtr<T, Arena>::operator=(
+    CompactRefCountedPtr<T, Arena> &other) {
+  if (this != &other) {
+    if (other.index != Arena.null_index) {
+      Arena.add_reference(other.index);
+    }
+    release_reference();
+    index = other.index;
+  }
+  return *this;
+}
+
+/**
+ * @brief Move assignment operator transferring ownership.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Arena The arena the object lives in.
+ * @param other The CompactRefCountedPtr to take ownership from; left empty.
+ * @return CompactRefCountedPtr<T, Arena>& Reference to this pointer.
+ */
+template <typename T, auto &Arena>
+CompactRefCountedPtr<T, Arena> &CompactRefCountedPtr<T, Arena>::operator=(
+    CompactRefCountedPtr<T, Arena> &&other) noexcept {
+  if (this != &other) {
+    release_reference();
+    index = other.index;
+    other.index = Arena.null_index;
+  }
+  return *this;
+}
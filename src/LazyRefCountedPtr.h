@@ -0,0 +1,113 @@
+#ifndef LAZYREFCOUNTEDPTR_HEADER
+#define LAZYREFCOUNTEDPTR_HEADER
+
+#include "RefCountedPtr.h"
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+/**
+ * @brief Shared pointer whose object is created by a factory on first access.
+ *
+ * Meant for globals pointing at expensive objects that most processes never
+ * use: nothing is built at startup, and the constructor is constexpr, so a
+ * global is constant-initialized without static-initialization-order
+ * concerns. The first access runs the factory exactly once, even when several
+ * threads race for it; concurrent callers block until it finishes. Every
+ * later access costs a single acquire load before handing out an ordinary
+ * RefCountedPtr.
+ *
+ * Like RefCountedStaticBlock, the reference it holds is never dropped, so the
+ * object stays alive through program exit and remains usable from the
+ * destructors of other statics. Use it for objects with static storage
+ * duration; a local instance leaks its object.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Factory Callable returning a RefCountedPtr<T, Counter>; the default
+ * accepts captureless lambdas and plain functions.
+ */
+template <typename T, typename Counter = RefCountedDefaultCounter,
+          typename Factory = RefCountedPtr<T, Counter> (*)()>
+class LazyRefCountedPtr {
+private:
+  /**
+   * @brief Progress of the one-time initialization.
+   */
+  enum State : std::uint8_t {
+    uninitialized, ///< The factory has not run yet.
+    running,       ///< A thread is running the factory.
+    ready          ///< data and control_block are published.
+  };
+
+  [[no_unique_address]] Factory factory; ///< Creates the object on first use.
+  std::atomic<std::uint8_t> state;       ///< Current State of initialization.
+  T *data;                               ///< The object, once ready.
+  RefCountedControlBlock<Counter>
+      *control_block; ///< Control block of the object, once ready.
+
+  /**
+   * @brief Runs the factory unless another thread already has, and waits
+   * until the object is published.
+   */
+  void initialize();
+
+public:
+  /**
+   * @brief Constructs a pointer that creates its object on first access.
+   *
+   * @param factory Callable creating the object.
+   */
+  constexpr explicit LazyRefCountedPtr(Factory factory)
+      : factory(std::move(factory)), state(uninitialized), data(nullptr),
+        control_block(nullptr) {}
+
+  LazyRefCountedPtr(const LazyRefCountedPtr<T, Counter, Factory> &) = delete;
+  LazyRefCountedPtr<T, Counter, Factory> &
+  operator=(const LazyRefCountedPtr<T, Counter, Factory> &) = delete;
+
+  /**
+   * @brief Checks whether the factory has already run.
+   *
+   * @return bool True if the object has been created.
+   */
+  bool is_initialized();
+
+  /**
+   * @brief Retrieves the raw pointer to the managed object, creating it if
+   * needed.
+   *
+   * @return T* The object, or nullptr if the factory returned an empty
+   * pointer.
+   */
+  T *get_data();
+
+  /**
+   * @brief Retrieves a pointer sharing ownership of the managed object,
+   * creating it if needed.
+   *
+   * @return RefCountedPtr<T, Counter> Pointer to the object.
+   */
+  RefCountedPtr<T, Counter> get_ptr();
+};
+
+/**
+ * @brief Creates a LazyRefCountedPtr from any callable, deducing its type.
+ *
+ * The result can initialize a constinit global when the callable is a
+ * literal type, such as a lambda capturing only constants.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Factory Callable returning a RefCountedPtr<T, Counter>.
+ * @param factory Callable creating the object on first access.
+ * @return LazyRefCountedPtr<T, Counter, Factory> The lazy pointer.
+ */
+template <typename T, typename Counter = RefCountedDefaultCounter,
+          typename Factory>
+constexpr LazyRefCountedPtr<T, Counter, Factory>
+make_lazy_ref_counted(Factory);
+
+#include "LazyRefCountedPtr.tpp"
+
+#endif
@@ -0,0 +1,110 @@
+#include "LazyRefCountedPtr.h"
+
+/**
+ * @brief Runs the factory unless another thread already has, and waits until
+ * the object is published.
+ *
+ * The thread that moves the state from uninitialized to running calls the
+ * factory; the others sleep on the state with atomic::wait. If the factory
+ * throws, the state is reset so that a later access can retry, and the
+ * exception propagates to the caller that ran it.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Factory Callable creating the object.
+ */
+template <typename T, typename Counter, typename Factory>
+void LazyRefCountedPtr<T, Counter, Factory>::initialize() {
+  std::uint8_t current = state.load(std::memory_order_acquire);
+  while (current != ready) {
+    if (current == uninitialized) {
+      if (!state.compare_exchange_strong(current, running,
+                                         std::memory_order_acquire)) {
+        continue;
+      }
+      RefCountedPtr<T, Counter> created;
+      try {
+        created = factory();
+      } catch (...) {
+        state.store(uninitialized, std::memory_order_release);
+        state.notify_all();
+        throw;
+      }
+      // Copies are made concurrently, so the block must exist up front.
+      created.share();
+      data = created.data;
+      control_block = created.control_block;
+      created.data = nullptr;
+      created.control_block = nullptr;
+      state.store(ready, std::memory_order_release);
+      state.notify_all();
+      return;
+    }
+    state.wait(running, std::memory_order_acquire);
+    current = state.load(std::memory_order_acquire);
+  }
+}
+
+/**
+ * @brief Checks whether the factory has already run.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Factory Callable creating the object.
+ * @return bool True if the object has been created.
+ */
+template <typename T, typename Counter, typename Factory>
+bool LazyRefCountedPtr<T, Counter, Factory>::is_initialized() {
+  return state.load(std::memory_order_acquire) == ready;
+}
+
+/**
+ * @brief Retrieves the raw pointer to the managed object, creating it if
+ * needed.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Factory Callable creating the object.
+ * @return T* The object, or nullptr if the factory returned an empty pointer.
+ */
+template <typename T, typename Counter, typename Factory>
+T *LazyRefCountedPtr<T, Counter, Factory>::get_data() {
+  if (state.load(std::memory_order_acquire) != ready) {
+    initialize();
+  }
+  return data;
+}
+
+/**
+ * @brief Retrieves a pointer sharing ownership of the managed object,
+ * creating it if needed.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Factory Callable creating the object.
+ * @return RefCountedPtr<T, Counter> Pointer to the object.
+ */
+template <typename T, typename Counter, typename Factory>
+RefCountedPtr<T, Counter> LazyRefCountedPtr<T, Counter, Factory>::get_ptr() {
+  if (state.load(std::memory_order_acquire) != ready) {
+    initialize();
+  }
+  RefCountedPtr<T, Counter> pointer;
+  pointer.init_data(data, control_block);
+  return pointer;
+}
+
+/**
+ * @brief Creates a LazyRefCountedPtr from any callable, deducing its type.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Factory Callable returning a RefCountedPtr<T, Counter>.
+ * @param factory Callable creating the object on first access.
+ * @return LazyRefCountedPtr<T, Counter, Factory> The lazy pointer.
+ */
+template <typename T, typename Counter, typename Factory>
+constexpr LazyRefCountedPtr<T, Counter, Factory>
+make_lazy_ref_counted(Factory factory) {
+  return LazyRefCountedPtr<T, Counter, Factory>(std::move(factory));
+}
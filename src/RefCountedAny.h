@@ -0,0 +1,174 @@
+#ifndef REFCOUNTEDANY_HEADER
+#define REFCOUNTEDANY_HEADER
+
+#include "RefCountedPtr.h"
+#include <type_traits>
+#include <typeinfo>
+
+/**
+ * @brief Identity of a type stored in a RefCountedAny.
+ *
+ * Within one shared library the address of id is unique for every T, so type
+ * checks usually compare two pointers. Libraries built with hidden visibility
+ * each get their own copy of id; its value, the type_info of T *, still
+ * identifies the type across them. The pointer type keeps const T and T
+ * apart, which typeid(T) would not.
+ *
+ * @tparam T The stored type.
+ */
+template <typename T> struct RefCountedTypeTag {
+  static constexpr const std::type_info *id = &typeid(T *); ///< Type of T *.
+};
+
+/**
+ * @brief Type-erased shared pointer to an object of any type.
+ *
+ * Holds a RefCountedPtr<void> together with a tag naming the stored type.
+ * The control block still knows how to release the original type, so no
+ * common base class or virtual destructor is needed, and objects created
+ * with make_ref_counted_any share one allocation with their control block.
+ * Typed access checks the tag with a single pointer comparison and then uses
+ * the stored pointer directly; only when the addresses differ, as they do for
+ * objects stored by a library with hidden visibility, are the type_info
+ * objects compared.
+ *
+ * Pointers to const objects are accepted and keep their constness: an object
+ * stored from a RefCountedPtr<const T> is only found as const T.
+ *
+ * @tparam Counter The reference count policy.
+ */
+template <typename Counter = RefCountedDefaultCounter>
+class REFCOUNTEDPTR_TRIVIALLY_RELOCATABLE REFCOUNTEDPTR_TRIVIAL_ABI
+    RefCountedAny {
+private:
+  RefCountedPtr<void, Counter> pointer; ///< The type-erased object.
+  const std::type_info *const
+      *type; ///< Tag of the stored type, or nullptr if empty.
+
+  /**
+   * @brief Converts a pointer to the untyped pointer stored, dropping const.
+   *
+   * @tparam T The type of the object.
+   * @param data The object.
+   * @return void* The same address; the tag keeps the constness.
+   */
+  template <typename T> static void *erase(T *);
+
+public:
+  /**
+   * @brief Default constructor creating an empty RefCountedAny.
+   */
+  constexpr RefCountedAny() : type(nullptr) {}
+
+  /**
+   * @brief Shares ownership of the object of a typed pointer.
+   *
+   * @tparam T The type of the object.
+   * @param other The pointer to share ownership with.
+   */
+  template <typename T>
+    requires(!std::is_void_v<T> && !std::is_array_v<T>)
+  RefCountedAny(RefCountedPtr<T, Counter> &);
+
+  /**
+   * @brief Takes over the object of a typed pointer without touching the
+   * reference count.
+   *
+   * @tparam T The type of the object.
+   * @param other The pointer to take ownership from; left empty.
+   */
+  template <typename T>
+    requires(!std::is_void_v<T> && !std::is_array_v<T>)
+  RefCountedAny(RefCountedPtr<T, Counter> &&);
+
+  /**
+   * @brief Copy constructor for sharing ownership.
+   *
+   * @param other The RefCountedAny to share ownership with.
+   */
+  RefCountedAny(RefCountedAny<Counter> &);
+
+  /**
+   * @brief Move constructor transferring ownership.
+   *
+   * @param other The RefCountedAny to take ownership from; left empty.
+   */
+  RefCountedAny(RefCountedAny<Counter> &&) noexcept;
+
+  /**
+   * @brief Checks whether an object is stored.
+   *
+   * @return bool True if the RefCountedAny is not empty.
+   */
+  bool has_value();
+
+  /**
+   * @brief Checks whether the stored object has exactly the type T.
+   *
+   * @tparam T The type to check for.
+   * @return bool True if an object of type T is stored.
+   */
+  template <typename T> bool has_type();
+
+  /**
+   * @brief Retrieves the stored object if it has exactly the type T.
+   *
+   * @tparam T The requested type.
+   * @return T* The object, or nullptr if it is empty or of another type.
+   */
+  template <typename T> T *get_data();
+
+  /**
+   * @brief Retrieves a typed pointer sharing ownership of the stored object
+   * if it has exactly the type T.
+   *
+   * @tparam T The requested type.
+   * @return RefCountedPtr<T, Counter> Pointer to the object, or an empty
+   * pointer if it is empty or of another type.
+   */
+  template <typename T> RefCountedPtr<T, Counter> get_ptr();
+
+  /**
+   * @brief Assignment operator for sharing ownership.
+   *
+   * @param other The RefCountedAny to assign from.
+   * @return RefCountedAny<Counter>& Reference to this RefCountedAny.
+   */
+  RefCountedAny<Counter> &operator=(RefCountedAny<Counter> &);
+
+  /**
+   * @brief Move assignment operator transferring ownership.
+   *
+   * @param other The RefCountedAny to take ownership from; left empty.
+   * @return RefCountedAny<Counter>& Reference to this RefCountedAny.
+   */
+  RefCountedAny<Counter> &operator=(RefCountedAny<Counter> &&) noexcept;
+};
+
+/**
+ * @brief Creates an object of type T and its control block in a single
+ * allocation and stores it type-erased.
+ *
+ * @tparam T The type of the object.
+ * @tparam Counter The reference count policy.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param args Arguments to pass to the T constructor.
+ * @return RefCountedAny<Counter> The new object.
+ */
+template <typename T, typename Counter = RefCountedDefaultCounter,
+          typename... Args>
+RefCountedAny<Counter> make_ref_counted_any(Args &&...);
+
+/**
+ * @brief RefCountedAny only holds pointers, so it can be relocated with a
+ * memory copy.
+ *
+ * @tparam Counter The reference count policy.
+ */
+template <typename Counter>
+struct ref_counted_is_trivially_relocatable<RefCountedAny<Counter>>
+    : std::true_type {};
+
+#include "RefCountedAny.tpp"
+
+#endif
@@ -0,0 +1,186 @@
+#include "RefCountedAny.h"
+#include <utility>
+
+/**
+ * @brief Converts a pointer to the untyped pointer stored, dropping const.
+ *
+ * @tparam Counter The reference count policy.
+ * @tparam T The type of the object.
+ * @param data The object.
+ * @return void* The same address; the tag keeps the constness.
+ */
+template <typename Counter>
+template <typename T>
+void *RefCountedAny<Counter>::erase(T *data) {
+  return const_cast<void *>(static_cast<const volatile void *>(data));
+}
+
+/**
+ * @brief Shares ownership of the object of a typed pointer.
+ *
+ * @tparam Counter The reference count policy.
+ * @tparam T The type of the object.
+ * @param other The pointer to share ownership with.
+ */
+template <typename Counter>
+template <typename T>
+  requires(!std::is_void_v<T> && !std::is_array_v<T>)
+RefCountedAny<Counter>::RefCountedAny(RefCountedPtr<T, Counter> &other)
+    : pointer(other, erase(other.get_data())) {
+  type = pointer.get_data() != nullptr ? &RefCountedTypeTag<T>::id : nullptr;
+}
+
+/**
+ * @brief Takes over the object of a typed pointer without touching the
+ * reference count.
+ *
+ * @tparam Counter The reference count policy.
+ * @tparam T The type of the object.
+ * @param other The pointer to take ownership from; left empty.
+ */
+template <typename Counter>
+template <typename T>
+  requires(!std::is_void_v<T> && !std::is_array_v<T>)
+RefCountedAny<Counter>::RefCountedAny(RefCountedPtr<T, Counter> &&other) {
+  if constexpr (std::is_same_v<std::remove_cv_t<T>, T>) {
+    pointer = std::move(other);
+  } else {
+    // RefCountedPtr<void> cannot adopt a pointer to const, so share and drop
+    pointer = RefCountedPtr<void, Counter>(other, erase(other.get_data()));
+    other = RefCountedPtr<T, Counter>();
+  }
+  type = pointer.get_data() != nullptr ? &RefCountedTypeTag<T>::id : nullptr;
+}
+
+/**
+ * @brief Copy constructor for sharing ownership.
+ *
+ * @tparam Counter The reference count policy.
+ * @param other The RefCountedAny to share ownership with.
+ */
+template <typename Counter>
+RefCountedAny<Counter>::RefCountedAny(RefCountedAny<Counter> &other)
+    : pointer(other.pointer), type(other.type) {}
+
+/**
+ * @brief Move constructor transferring ownership.
+ *
+ * @tparam Counter The reference count policy.
+ * @param other The RefCountedAny to take ownership from; left empty.
+ */
+template <typename Counter>
+RefCountedAny<Counter>::RefCountedAny(RefCountedAny<Counter> &&other) noexcept
+    : pointer(std::move(other.pointer)), type(other.type) {
+  other.type = nullptr;
+}
+
+/**
+ * @brief Checks whether an object is stored.
+ *
+ * @tparam Counter The reference count policy.
+ * @return bool True if the RefCountedAny is not empty.
+ */
+template <typename Counter> bool RefCountedAny<Counter>::has_value() {
+  return type != nullptr;
+}
+
+/**
+ * @brief Checks whether the stored object has exactly the type T.
+ *
+ * Compares the tag addresses first. They only differ for the same type when
+ * it was stored by a library with hidden visibility, so a mismatch falls
+ * back to comparing the type_info objects.
+ *
+ * @tparam Counter The reference count policy.
+ * @tparam T The type to check for.
+ * @return bool True if an object of type T is stored.
+ */
+template <typename Counter>
+template <typename T>
+bool RefCountedAny<Counter>::has_type() {
+  if (type == &RefCountedTypeTag<T>::id) {
+    return true;
+  }
+  return type != nullptr && **type == *RefCountedTypeTag<T>::id;
+}
+
+/**
+ * @brief Retrieves the stored object if it has exactly the type T.
+ *
+ * @tparam Counter The reference count policy.
+ * @tparam T The requested type.
+ * @return T* The object, or nullptr if it is empty or of another type.
+ */
+template <typename Counter>
+template <typename T>
+T *RefCountedAny<Counter>::get_data() {
+  return has_type<T>() ? static_cast<T *>(pointer.get_data()) : nullptr;
+}
+
+/**
+ * @brief Retrieves a typed pointer sharing ownership of the stored object if
+ * it has exactly the type T.
+ *
+ * @tparam Counter The reference count policy.
+ * @tparam T The requested type.
+ * @return RefCountedPtr<T, Counter> Pointer to the object, or an empty
+ * pointer if it is empty or of another type.
+ */
+template <typename Counter>
+template <typename T>
+RefCountedPtr<T, Counter> RefCountedAny<Counter>::get_ptr() {
+  if (!has_type<T>()) {
+    return RefCountedPtr<T, Counter>();
+  }
+  return RefCountedPtr<T, Counter>(pointer,
+                                   static_cast<T *>(pointer.get_data()));
+}
+
+/**
+ * @brief Assignment operator for sharing ownership.
+ *
+ * @tparam Counter The reference count policy.
+ * @param other The RefCountedAny to assign from.
+ * @return RefCountedAny<Counter>& Reference to this RefCountedAny.
+ */
+template <typename Counter>
+RefCountedAny<Counter> &
+RefCountedAny<Counter>::operator=(RefCountedAny<Counter> &other) {
+  pointer = other.pointer;
+  type = other.type;
+  return *this;
+}
+
+/**
+ * @brief Move assignment operator transferring ownership.
+ *
+ * @tparam Counter The reference count policy.
+ * @param other The RefCountedAny to take ownership from; left empty.
+ * @return RefCountedAny<Counter>& Reference to this RefCountedAny.
+ */
+template <typename Counter>
+RefCountedAny<Counter> &
+RefCountedAny<Counter>::operator=(RefCountedAny<Counter> &&other) noexcept {
+  if (this != &other) {
+    pointer = std::move(other.pointer);
+    type = other.type;
+    other.type = nullptr;
+  }
+  return *this;
+}
+
+/**
+ * @brief Creates an object of type T and its control block in a single
+ * allocation and stores it type-erased.
+ *
+ * @tparam T The type of the object.
+ * @tparam Counter The reference count policy.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param args Arguments forwarded to the T constructor.
+ * @return RefCountedAny<Counter> The new object.
+ */
+template <typename T, typename Counter, typename... Args>
+RefCountedAny<Counter> make_ref_counted_any(Args &&...args) {
+  return RefCountedAny<Counter>(RefCountedPtr<T, Counter>(
+      ref_counted_packed, std::forward<Args>(args)...));
+}
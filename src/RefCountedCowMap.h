@@ -0,0 +1,166 @@
+#ifndef REFCOUNTEDCOWMAP_HEADER
+#define REFCOUNTEDCOWMAP_HEADER
+
+#include "RefCountedFlatMap.h"
+#include "RefCountedPtr.h"
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+/**
+ * @brief Copy-on-write sorted map whose copies share one RefCountedFlatMap.
+ *
+ * Copying the map only adds a reference. The first modification made
+ * through a copy whose entries are shared clones them; while a copy is the
+ * only owner, every modification happens in place after a single load of
+ * the reference count. Lookups never clone.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ */
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+class RefCountedCowMap {
+private:
+  RefCountedPtr<RefCountedFlatMap<Key, Value, Compare>>
+      entries; ///< Shared entries; empty until the first insertion.
+
+public:
+  /**
+   * @brief Default constructor creating an empty map without allocating.
+   */
+  RefCountedCowMap() = default;
+
+  /**
+   * @brief Copy constructor sharing the entries of another map.
+   *
+   * @param other The map to share the entries with.
+   */
+  RefCountedCowMap(RefCountedCowMap<Key, Value, Compare> &);
+
+  /**
+   * @brief Move constructor taking over the entries of another map.
+   *
+   * @param other The map to take the entries from; left empty.
+   */
+  RefCountedCowMap(RefCountedCowMap<Key, Value, Compare> &&) noexcept =
+      default;
+
+  /**
+   * @brief Retrieves the number of entries.
+   *
+   * @return std::size_t The number of entries.
+   */
+  std::size_t size();
+
+  /**
+   * @brief Checks whether the entries are shared with another copy.
+   *
+   * @return bool True if the next modification would clone the entries.
+   */
+  bool is_shared();
+
+  /**
+   * @brief Checks whether an entry with the given key exists.
+   *
+   * @param key The key to look up.
+   * @return bool True if the key is present.
+   */
+  bool contains(const Key &);
+
+  /**
+   * @brief Looks up the value stored under a key for reading.
+   *
+   * @param key The key to look up.
+   * @return const Value* The value, or nullptr if the key is not present.
+   */
+  const Value *find(const Key &);
+
+  /**
+   * @brief Retrieves the entries for modification, cloning them if shared.
+   *
+   * Checks the count once for a whole batch of modifications. The reference
+   * must not be used after this map has been copied, since the copy shares
+   * the entries.
+   *
+   * @return RefCountedFlatMap<Key, Value, Compare>& Entries owned only by
+   * this map.
+   */
+  RefCountedFlatMap<Key, Value, Compare> &make_mutable();
+
+  /**
+   * @brief Looks up the value stored under a key for modification, cloning
+   * the entries if they are shared.
+   *
+   * @param key The key to look up.
+   * @return Value* The value, or nullptr if the key is not present.
+   */
+  Value *find_mutable(const Key &);
+
+  /**
+   * @brief Inserts an entry unless the key is already present, cloning the
+   * entries if they are shared.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param key The key of the new entry.
+   * @param args Arguments to pass to the Value constructor.
+   * @return std::pair<Value *, bool> The value stored under key, and whether
+   * it was inserted by this call.
+   */
+  template <typename... Args>
+  std::pair<Value *, bool> emplace(const Key &, Args &&...);
+
+  /**
+   * @brief Removes the entry with the given key, cloning the entries only if
+   * the key is present and they are shared.
+   *
+   * @param key The key to remove.
+   * @return bool True if an entry was removed.
+   */
+  bool erase(const Key &);
+
+  /**
+   * @brief Removes every entry.
+   *
+   * Shared entries are left to the other copies instead of being cloned.
+   */
+  void clear();
+
+  /**
+   * @brief Retrieves an iterator to the entry with the smallest key for
+   * reading.
+   *
+   * @return const std::pair<Key, Value>* The first entry.
+   */
+  const std::pair<Key, Value> *begin();
+
+  /**
+   * @brief Retrieves an iterator past the entry with the largest key for
+   * reading.
+   *
+   * @return const std::pair<Key, Value>* One past the last entry.
+   */
+  const std::pair<Key, Value> *end();
+
+  /**
+   * @brief Assignment operator sharing the entries of another map.
+   *
+   * @param other The map to share the entries with.
+   * @return RefCountedCowMap<Key, Value, Compare>& Reference to this map.
+   */
+  RefCountedCowMap<Key, Value, Compare> &
+  operator=(RefCountedCowMap<Key, Value, Compare> &);
+
+  /**
+   * @brief Move assignment operator taking over the entries of another map.
+   *
+   * @param other The map to take the entries from; left empty.
+   * @return RefCountedCowMap<Key, Value, Compare>& Reference to this map.
+   */
+  RefCountedCowMap<Key, Value, Compare> &
+  operator=(RefCountedCowMap<Key, Value, Compare> &&) noexcept = default;
+};
+
+#include "RefCountedCowMap.tpp"
+
+#endif
@@ -0,0 +1,219 @@
+#include "RefCountedCowMap.h"
+#include <utility>
+
+/**
+ * @brief Retrieves the entries for modification, cloning them if shared.
+ *
+ * The entries are allocated on first use, so empty maps cost nothing.
+ * Every other modification goes through here.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @return RefCountedFlatMap<Key, Value, Compare>& Entries owned only by this
+ * map.
+ */
+template <typename Key, typename Value, typename Compare>
+RefCountedFlatMap<Key, Value, Compare> &
+RefCountedCowMap<Key, Value, Compare>::make_mutable() {
+  if (entries.get_data() == nullptr) {
+    entries = RefCountedPtr<RefCountedFlatMap<Key, Value, Compare>>(
+        ref_counted_packed);
+  }
+  return *entries.make_mutable();
+}
+
+/**
+ * @brief Copy constructor sharing the entries of another map.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @param other The map to share the entries with.
+ */
+template <typename Key, typename Value, typename Compare>
+RefCountedCowMap<Key, Value, Compare>::RefCountedCowMap(
+    RefCountedCowMap<Key, Value, Compare> &other)
+    : entries(other.entries) {}
+
+/**
+ * @brief Retrieves the number of entries.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @return std::size_t The number of entries.
+ */
+template <typename Key, typename Value, typename Compare>
+std::size_t RefCountedCowMap<Key, Value, Compare>::size() {
+  RefCountedFlatMap<Key, Value, Compare> *shared = entries.get_data();
+  return shared != nullptr ? shared->size() : 0;
+}
+
+/**
+ * @brief Checks whether the entries are shared with another copy.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @return bool True if the next modification would clone the entries.
+ */
+template <typename Key, typename Value, typename Compare>
+bool RefCountedCowMap<Key, Value, Compare>::is_shared() {
+  return entries.get_data() != nullptr && !entries.is_unique();
+}
+
+/**
+ * @brief Checks whether an entry with the given key exists.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @param key The key to look up.
+ * @return bool True if the key is present.
+ */
+template <typename Key, typename Value, typename Compare>
+bool RefCountedCowMap<Key, Value, Compare>::contains(const Key &key) {
+  RefCountedFlatMap<Key, Value, Compare> *shared = entries.get_data();
+  return shared != nullptr && shared->contains(key);
+}
+
+/**
+ * @brief Looks up the value stored under a key for reading.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @param key The key to look up.
+ * @return const Value* The value, or nullptr if the key is not present.
+ */
+template <typename Key, typename Value, typename Compare>
+const Value *RefCountedCowMap<Key, Value, Compare>::find(const Key &key) {
+  RefCountedFlatMap<Key, Value, Compare> *shared = entries.get_data();
+  return shared != nullptr ? shared->find(key) : nullptr;
+}
+
+/**
+ * @brief Looks up the value stored under a key for modification, cloning the
+ * entries if they are shared.
+ *
+ * A missing key is reported without cloning.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @param key The key to look up.
+ * @return Value* The value, or nullptr if the key is not present.
+ */
+template <typename Key, typename Value, typename Compare>
+Value *RefCountedCowMap<Key, Value, Compare>::find_mutable(const Key &key) {
+  if (!contains(key)) {
+    return nullptr;
+  }
+  return make_mutable().find(key);
+}
+
+/**
+ * @brief Inserts an entry unless the key is already present, cloning the
+ * entries if they are shared.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param key The key of the new entry.
+ * @param args Arguments forwarded to the Value constructor.
+ * @return std::pair<Value *, bool> The value stored under key, and whether it
+ * was inserted by this call.
+ */
+template <typename Key, typename Value, typename Compare>
+template <typename... Args>
+std::pair<Value *, bool>
+RefCountedCowMap<Key, Value, Compare>::emplace(const Key &key,
+                                               Args &&...args) {
+  return make_mutable().emplace(key, std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Removes the entry with the given key, cloning the entries only if
+ * the key is present and they are shared.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @param key The key to remove.
+ * @return bool True if an entry was removed.
+ */
+template <typename Key, typename Value, typename Compare>
+bool RefCountedCowMap<Key, Value, Compare>::erase(const Key &key) {
+  if (!contains(key)) {
+    return false;
+  }
+  return make_mutable().erase(key);
+}
+
+/**
+ * @brief Removes every entry.
+ *
+ * A unique owner keeps its storage for reuse; a shared one just drops its
+ * reference.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ */
+template <typename Key, typename Value, typename Compare>
+void RefCountedCowMap<Key, Value, Compare>::clear() {
+  if (is_shared()) {
+    entries = RefCountedPtr<RefCountedFlatMap<Key, Value, Compare>>();
+  } else if (entries.get_data() != nullptr) {
+    entries.get_data()->clear();
+  }
+}
+
+/**
+ * @brief Retrieves an iterator to the entry with the smallest key for
+ * reading.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @return const std::pair<Key, Value>* The first entry.
+ */
+template <typename Key, typename Value, typename Compare>
+const std::pair<Key, Value> *RefCountedCowMap<Key, Value, Compare>::begin() {
+  RefCountedFlatMap<Key, Value, Compare> *shared = entries.get_data();
+  return shared != nullptr ? shared->begin() : nullptr;
+}
+
+/**
+ * @brief Retrieves an iterator past the entry with the largest key for
+ * reading.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @return const std::pair<Key, Value>* One past the last entry.
+ */
+template <typename Key, typename Value, typename Compare>
+const std::pair<Key, Value> *RefCountedCowMap<Key, Value, Compare>::end() {
+  RefCountedFlatMap<Key, Value, Compare> *shared = entries.get_data();
+  return shared != nullptr ? shared->end() : nullptr;
+}
+
+/**
+ * @brief Assignment operator sharing the entries of another map.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @param other The map to share the entries with.
+ * @return RefCountedCowMap<Key, Value, Compare>& Reference to this map.
+ */
+template <typename Key, typename Value, typename Compare>
+RefCountedCowMap<Key, Value, Compare> &
+RefCountedCowMap<Key, Value, Compare>::operator=(
+    RefCountedCowMap<Key, Value, Compare> &other) {
+  entries = other.entries;
+  return *this;
+}
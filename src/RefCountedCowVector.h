@@ -0,0 +1,151 @@
+#ifndef REFCOUNTEDCOWVECTOR_HEADER
+#define REFCOUNTEDCOWVECTOR_HEADER
+
+#include "RefCountedPtr.h"
+#include "RefCountedVector.h"
+#include <cstddef>
+
+/**
+ * @brief Copy-on-write vector whose copies share one RefCountedVector.
+ *
+ * Copying the vector only adds a reference. The first modification made
+ * through a copy whose elements are shared clones them; while a copy is the
+ * only owner, every modification happens in place after a single load of
+ * the reference count.
+ *
+ * @tparam T The element type.
+ */
+template <typename T> class RefCountedCowVector {
+private:
+  RefCountedPtr<RefCountedVector<T>>
+      elements; ///< Shared elements; empty until the first insertion.
+
+public:
+  /**
+   * @brief Default constructor creating an empty vector without allocating.
+   */
+  RefCountedCowVector() = default;
+
+  /**
+   * @brief Copy constructor sharing the elements of another vector.
+   *
+   * @param other The vector to share the elements with.
+   */
+  RefCountedCowVector(RefCountedCowVector<T> &);
+
+  /**
+   * @brief Move constructor taking over the elements of another vector.
+   *
+   * @param other The vector to take the elements from; left empty.
+   */
+  RefCountedCowVector(RefCountedCowVector<T> &&) noexcept = default;
+
+  /**
+   * @brief Retrieves the number of elements.
+   *
+   * @return std::size_t The number of elements.
+   */
+  std::size_t size();
+
+  /**
+   * @brief Checks whether the elements are shared with another copy.
+   *
+   * @return bool True if the next modification would clone the elements.
+   */
+  bool is_shared();
+
+  /**
+   * @brief Reads an element without bounds checking.
+   *
+   * @param index Index of the element.
+   * @return const T& Reference to the element.
+   */
+  const T &operator[](std::size_t);
+
+  /**
+   * @brief Retrieves an iterator to the first element for reading.
+   *
+   * @return const T* The first element.
+   */
+  const T *begin();
+
+  /**
+   * @brief Retrieves an iterator past the last element for reading.
+   *
+   * @return const T* One past the last element.
+   */
+  const T *end();
+
+  /**
+   * @brief Retrieves the elements for modification, cloning them if shared.
+   *
+   * Checks the count once for a whole batch of modifications, instead of
+   * once per element as get_mutable does. The reference must not be used
+   * after this vector has been copied, since the copy shares the elements.
+   *
+   * @return RefCountedVector<T>& Elements owned only by this vector.
+   */
+  RefCountedVector<T> &make_mutable();
+
+  /**
+   * @brief Accesses an element for modification, cloning the elements if
+   * they are shared.
+   *
+   * @param index Index of the element.
+   * @return T& Reference to the element.
+   */
+  T &get_mutable(std::size_t);
+
+  /**
+   * @brief Constructs an element at the end, cloning the elements if they
+   * are shared.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param args Arguments to pass to the T constructor.
+   * @return T& Reference to the new element.
+   */
+  template <typename... Args> T &emplace_back(Args &&...);
+
+  /**
+   * @brief Destroys the last element, cloning the elements if they are
+   * shared.
+   */
+  void pop_back();
+
+  /**
+   * @brief Destroys the element at the given index, cloning the elements if
+   * they are shared.
+   *
+   * @param index Index of the element to erase.
+   */
+  void erase(std::size_t);
+
+  /**
+   * @brief Removes every element.
+   *
+   * Shared elements are left to the other copies instead of being cloned.
+   */
+  void clear();
+
+  /**
+   * @brief Assignment operator sharing the elements of another vector.
+   *
+   * @param other The vector to share the elements with.
+   * @return RefCountedCowVector<T>& Reference to this vector.
+   */
+  RefCountedCowVector<T> &operator=(RefCountedCowVector<T> &);
+
+  /**
+   * @brief Move assignment operator taking over the elements of another
+   * vector.
+   *
+   * @param other The vector to take the elements from; left empty.
+   * @return RefCountedCowVector<T>& Reference to this vector.
+   */
+  RefCountedCowVector<T> &
+  operator=(RefCountedCowVector<T> &&) noexcept = default;
+};
+
+#include "RefCountedCowVector.tpp"
+
+#endif
@@ -0,0 +1,162 @@
+#include "RefCountedCowVector.h"
+#include <utility>
+
+/**
+ * @brief Retrieves the elements for modification, cloning them if shared.
+ *
+ * The elements are allocated on first use, so empty vectors cost nothing.
+ * Every other modification goes through here.
+ *
+ * @tparam T The element type.
+ * @return RefCountedVector<T>& Elements owned only by this vector.
+ */
+template <typename T>
+RefCountedVector<T> &RefCountedCowVector<T>::make_mutable() {
+  if (elements.get_data() == nullptr) {
+    elements = RefCountedPtr<RefCountedVector<T>>(ref_counted_packed);
+  }
+  return *elements.make_mutable();
+}
+
+/**
+ * @brief Copy constructor sharing the elements of another vector.
+ *
+ * @tparam T The element type.
+ * @param other The vector to share the elements with.
+ */
+template <typename T>
+RefCountedCowVector<T>::RefCountedCowVector(RefCountedCowVector<T> &other)
+    : elements(other.elements) {}
+
+/**
+ * @brief Retrieves the number of elements.
+ *
+ * @tparam T The element type.
+ * @return std::size_t The number of elements.
+ */
+template <typename T> std::size_t RefCountedCowVector<T>::size() {
+  RefCountedVector<T> *shared = elements.get_data();
+  return shared != nullptr ? shared->size() : 0;
+}
+
+/**
+ * @brief Checks whether the elements are shared with another copy.
+ *
+ * @tparam T The element type.
+ * @return bool True if the next modification would clone the elements.
+ */
+template <typename T> bool RefCountedCowVector<T>::is_shared() {
+  return elements.get_data() != nullptr && !elements.is_unique();
+}
+
+/**
+ * @brief Reads an element without bounds checking.
+ *
+ * @tparam T The element type.
+ * @param index Index of the element.
+ * @return const T& Reference to the element.
+ */
+template <typename T>
+const T &RefCountedCowVector<T>::operator[](std::size_t index) {
+  return (*elements.get_data())[index];
+}
+
+/**
+ * @brief Retrieves an iterator to the first element for reading.
+ *
+ * @tparam T The element type.
+ * @return const T* The first element.
+ */
+template <typename T> const T *RefCountedCowVector<T>::begin() {
+  RefCountedVector<T> *shared = elements.get_data();
+  return shared != nullptr ? shared->begin() : nullptr;
+}
+
+/**
+ * @brief Retrieves an iterator past the last element for reading.
+ *
+ * @tparam T The element type.
+ * @return const T* One past the last element.
+ */
+template <typename T> const T *RefCountedCowVector<T>::end() {
+  RefCountedVector<T> *shared = elements.get_data();
+  return shared != nullptr ? shared->end() : nullptr;
+}
+
+/**
+ * @brief Accesses an element for modification, cloning the elements if they
+ * are shared.
+ *
+ * @tparam T The element type.
+ * @param index Index of the element.
+ * @return T& Reference to the element.
+ */
+template <typename T>
+T &RefCountedCowVector<T>::get_mutable(std::size_t index) {
+  return make_mutable()[index];
+}
+
+/**
+ * @brief Constructs an element at the end, cloning the elements if they are
+ * shared.
+ *
+ * @tparam T The element type.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param args Arguments forwarded to the T constructor.
+ * @return T& Reference to the new element.
+ */
+template <typename T>
+template <typename... Args>
+T &RefCountedCowVector<T>::emplace_back(Args &&...args) {
+  return make_mutable().emplace_back(std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Destroys the last element, cloning the elements if they are shared.
+ *
+ * @tparam T The element type.
+ */
+template <typename T> void RefCountedCowVector<T>::pop_back() {
+  make_mutable().pop_back();
+}
+
+/**
+ * @brief Destroys the element at the given index, cloning the elements if
+ * they are shared.
+ *
+ * @tparam T The element type.
+ * @param index Index of the element to erase.
+ */
+template <typename T> void RefCountedCowVector<T>::erase(std::size_t index) {
+  make_mutable().erase(index);
+}
+
+/**
+ * @brief Removes every element.
+ *
+ * A unique owner keeps its storage for reuse; a shared one just drops its
+ * reference.
+ *
+ * @tparam T The element type.
+ */
+template <typename T> void RefCountedCowVector<T>::clear() {
+  if (is_shared()) {
+    elements = RefCountedPtr<RefCountedVector<T>>();
+  } else if (elements.get_data() != nullptr) {
+    elements.get_data()->clear();
+  }
+}
+
+/**
+ * @brief Assignment operator sharing the elements of another vector.
+ *
+ * @tparam T The element type.
+ * @param other The vector to share the elements with.
+ * @return RefCountedCowVector<T>& Reference to this vector.
+ */
+template <typename T>
+RefCountedCowVector<T> &
+RefCountedCowVector<T>::operator=(RefCountedCowVector<T> &other) {
+  elements = other.elements;
+  return *this;
+}
@@ -0,0 +1,128 @@
+#ifndef REFCOUNTEDFLATMAP_HEADER
+#define REFCOUNTEDFLATMAP_HEADER
+
+#include "RefCountedVector.h"
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+/**
+ * @brief Sorted associative container stored in a single RefCountedVector.
+ *
+ * Entries are kept ordered by key in contiguous storage, so lookups are a
+ * binary search over one array and iteration is a linear scan. Inserting or
+ * erasing in the middle relocates the tail, which for keys and values such
+ * as integers and RefCountedPtr is a single memmove with no reference count
+ * traffic.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ */
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+class RefCountedFlatMap {
+private:
+  RefCountedVector<std::pair<Key, Value>> entries; ///< Entries sorted by key.
+  [[no_unique_address]] Compare compare;           ///< The key ordering.
+
+  /**
+   * @brief Finds the first entry whose key is not less than the given key.
+   *
+   * @param key The key to search for.
+   * @return std::size_t Index of that entry, or size() if there is none.
+   */
+  std::size_t lower_bound(const Key &);
+
+  /**
+   * @brief Checks whether the entry at an index has the given key.
+   *
+   * @param index Index returned by lower_bound.
+   * @param key The key to compare with.
+   * @return bool True if the entry exists and its key is equal to key.
+   */
+  bool matches(std::size_t, const Key &);
+
+public:
+  /**
+   * @brief Constructs an empty map.
+   *
+   * @param compare The key ordering.
+   */
+  explicit RefCountedFlatMap(Compare compare = Compare())
+      : compare(std::move(compare)) {}
+
+  /**
+   * @brief Retrieves the number of entries.
+   *
+   * @return std::size_t The number of entries.
+   */
+  std::size_t size();
+
+  /**
+   * @brief Checks whether an entry with the given key exists.
+   *
+   * @param key The key to look up.
+   * @return bool True if the key is present.
+   */
+  bool contains(const Key &);
+
+  /**
+   * @brief Looks up the value stored under a key.
+   *
+   * @param key The key to look up.
+   * @return Value* The value, or nullptr if the key is not present.
+   */
+  Value *find(const Key &);
+
+  /**
+   * @brief Inserts an entry unless the key is already present.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param key The key of the new entry.
+   * @param args Arguments to pass to the Value constructor.
+   * @return std::pair<Value *, bool> The value stored under key, and whether
+   * it was inserted by this call.
+   */
+  template <typename... Args>
+  std::pair<Value *, bool> emplace(const Key &, Args &&...);
+
+  /**
+   * @brief Accesses the value stored under a key, inserting a
+   * value-initialized one if the key is not present.
+   *
+   * @param key The key to look up.
+   * @return Value& Reference to the value.
+   */
+  Value &operator[](const Key &);
+
+  /**
+   * @brief Removes the entry with the given key.
+   *
+   * @param key The key to remove.
+   * @return bool True if an entry was removed.
+   */
+  bool erase(const Key &);
+
+  /**
+   * @brief Removes every entry.
+   */
+  void clear();
+
+  /**
+   * @brief Retrieves an iterator to the entry with the smallest key.
+   *
+   * @return std::pair<Key, Value>* The first entry.
+   */
+  std::pair<Key, Value> *begin();
+
+  /**
+   * @brief Retrieves an iterator past the entry with the largest key.
+   *
+   * @return std::pair<Key, Value>* One past the last entry.
+   */
+  std::pair<Key, Value> *end();
+};
+
+#include "RefCountedFlatMap.tpp"
+
+#endif
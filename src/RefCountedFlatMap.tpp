@@ -0,0 +1,181 @@
+#include "RefCountedFlatMap.h"
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+/**
+ * @brief Finds the first entry whose key is not less than the given key.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @param key The key to search for.
+ * @return std::size_t Index of that entry, or size() if there is none.
+ */
+template <typename Key, typename Value, typename Compare>
+std::size_t
+RefCountedFlatMap<Key, Value, Compare>::lower_bound(const Key &key) {
+  std::pair<Key, Value> *found = std::lower_bound(
+      entries.begin(), entries.end(), key,
+      [this](std::pair<Key, Value> &entry, const Key &target) {
+        return compare(entry.first, target);
+      });
+  return static_cast<std::size_t>(found - entries.begin());
+}
+
+/**
+ * @brief Checks whether the entry at an index has the given key.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @param index Index returned by lower_bound.
+ * @param key The key to compare with.
+ * @return bool True if the entry exists and its key is equal to key.
+ */
+template <typename Key, typename Value, typename Compare>
+bool RefCountedFlatMap<Key, Value, Compare>::matches(std::size_t index,
+                                                     const Key &key) {
+  return index < entries.size() && !compare(key, entries[index].first);
+}
+
+/**
+ * @brief Retrieves the number of entries.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @return std::size_t The number of entries.
+ */
+template <typename Key, typename Value, typename Compare>
+std::size_t RefCountedFlatMap<Key, Value, Compare>::size() {
+  return entries.size();
+}
+
+/**
+ * @brief Checks whether an entry with the given key exists.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @param key The key to look up.
+ * @return bool True if the key is present.
+ */
+template <typename Key, typename Value, typename Compare>
+bool RefCountedFlatMap<Key, Value, Compare>::contains(const Key &key) {
+  return matches(lower_bound(key), key);
+}
+
+/**
+ * @brief Looks up the value stored under a key.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @param key The key to look up.
+ * @return Value* The value, or nullptr if the key is not present.
+ */
+template <typename Key, typename Value, typename Compare>
+Value *RefCountedFlatMap<Key, Value, Compare>::find(const Key &key) {
+  std::size_t index = lower_bound(key);
+  return matches(index, key) ? &entries[index].second : nullptr;
+}
+
+/**
+ * @brief Inserts an entry unless the key is already present.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param key The key of the new entry.
+ * @param args Arguments forwarded to the Value constructor.
+ * @return std::pair<Value *, bool> The value stored under key, and whether it
+ * was inserted by this call.
+ */
+template <typename Key, typename Value, typename Compare>
+template <typename... Args>
+std::pair<Value *, bool>
+RefCountedFlatMap<Key, Value, Compare>::emplace(const Key &key,
+                                                Args &&...args) {
+  std::size_t index = lower_bound(key);
+  if (matches(index, key)) {
+    return {&entries[index].second, false};
+  }
+  std::pair<Key, Value> &entry = entries.emplace(
+      index, std::piecewise_construct, std::forward_as_tuple(key),
+      std::forward_as_tuple(std::forward<Args>(args)...));
+  return {&entry.second, true};
+}
+
+/**
+ * @brief Accesses the value stored under a key, inserting a value-initialized
+ * one if the key is not present.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @param key The key to look up.
+ * @return Value& Reference to the value.
+ */
+template <typename Key, typename Value, typename Compare>
+Value &RefCountedFlatMap<Key, Value, Compare>::operator[](const Key &key) {
+  return *emplace(key).first;
+}
+
+/**
+ * @brief Removes the entry with the given key.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @param key The key to remove.
+ * @return bool True if an entry was removed.
+ */
+template <typename Key, typename Value, typename Compare>
+bool RefCountedFlatMap<Key, Value, Compare>::erase(const Key &key) {
+  std::size_t index = lower_bound(key);
+  if (!matches(index, key)) {
+    return false;
+  }
+  entries.erase(index);
+  return true;
+}
+
+/**
+ * @brief Removes every entry.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ */
+template <typename Key, typename Value, typename Compare>
+void RefCountedFlatMap<Key, Value, Compare>::clear() {
+  entries.clear();
+}
+
+/**
+ * @brief Retrieves an iterator to the entry with the smallest key.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @return std::pair<Key, Value>* The first entry.
+ */
+template <typename Key, typename Value, typename Compare>
+std::pair<Key, Value> *RefCountedFlatMap<Key, Value, Compare>::begin() {
+  return entries.begin();
+}
+
+/**
+ * @brief Retrieves an iterator past the entry with the largest key.
+ *
+ * @tparam Key The key type.
+ * @tparam Value The mapped type.
+ * @tparam Compare Strict weak ordering of keys.
+ * @return std::pair<Key, Value>* One past the last entry.
+ */
+template <typename Key, typename Value, typename Compare>
+std::pair<Key, Value> *RefCountedFlatMap<Key, Value, Compare>::end() {
+  return entries.end();
+}
@@ -1,109 +1,1984 @@
 #ifndef REFCOUNTEDPTR_HEADER
 #define REFCOUNTEDPTR_HEADER
 
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * @brief Size of a cache line assumed when separating the reference count from
+ * the managed object.
+ */
+inline constexpr std::size_t ref_counted_cache_line_size = 64;
+
+/**
+ * @brief Trait selecting whether an inline object is kept off the cache line
+ * of its reference count.
+ *
+ * Defaults to true for types that already request cache-line alignment. It can
+ * be specialized to true for types whose hot fields should not share a line
+ * with count updates, without over-aligning the type itself.
+ *
+ * @tparam T The type of the managed object.
+ */
+template <typename T>
+struct ref_counted_isolate_counter
+    : std::bool_constant<(alignof(T) >= ref_counted_cache_line_size)> {};
+
+/**
+ * @brief Alignment used for an object stored inline next to its reference
+ * count.
+ *
+ * Never lower than alignof(T), and at least a cache line when
+ * ref_counted_isolate_counter<T> is set.
+ *
+ * @tparam T The type of the managed object.
+ */
+template <typename T>
+inline constexpr std::size_t ref_counted_inplace_alignment =
+    ref_counted_isolate_counter<T>::value &&
+            alignof(T) < ref_counted_cache_line_size
+        ? ref_counted_cache_line_size
+        : alignof(T);
+
+/**
+ * @brief Memory layout of a control block that stores its object inline.
+ */
+enum class RefCountedLayout {
+  Packed,  ///< Tightest packing; neighbouring blocks may share cache lines.
+  Isolated ///< Block starts on, and fills, whole cache lines of its own.
+};
+
+/**
+ * @brief Tag type selecting the control block layout at construction.
+ *
+ * @tparam Layout The layout to construct the control block with.
+ */
+template <RefCountedLayout Layout> struct RefCountedLayoutTag {};
+
+/**
+ * @brief Tag requesting the packed control block layout.
+ */
+inline constexpr RefCountedLayoutTag<RefCountedLayout::Packed>
+    ref_counted_packed{};
+
+/**
+ * @brief Tag requesting the cache-line-isolated control block layout.
+ */
+inline constexpr RefCountedLayoutTag<RefCountedLayout::Isolated>
+    ref_counted_isolated{};
+
+/**
+ * @brief Tag type requesting lazy control block allocation at construction.
+ */
+struct RefCountedLazyTag {};
+
+/**
+ * @brief Tag requesting that the control block is only allocated once the
+ * pointer is first shared.
+ */
+inline constexpr RefCountedLazyTag ref_counted_lazy{};
+
+/**
+ * @brief Reference count policy selecting the width and overflow behaviour of
+ * the shared counter.
+ *
+ * - Counters of 32 bits or more (int, std::int32_t, std::int64_t) use plain
+ *   atomic increments and decrements.
+ * - Narrower counters (std::uint16_t, std::uint8_t) spill into a global
+ *   overflow table once they reach their maximum, so small-object control
+ *   blocks stay compact while fan-out is still unbounded.
+ * - Saturating counters stop at their maximum and pin the object as immortal;
+ *   it is never released once the count has saturated.
+ *
+ * @tparam Count Integer type stored in the control block.
+ * @tparam Saturating Whether the count saturates instead of overflowing.
+ */
+template <typename Count, bool Saturating = false> class RefCountedCounter {
+public:
+  static_assert(std::is_integral_v<Count>,
+                "the reference count must be an integer type");
+
+  using value_type = Count; ///< Integer type stored in the control block.
+
+  /**
+   * @brief Adds a reference to the count.
+   *
+   * @param count The shared reference count.
+   */
+  static void increment(std::atomic<Count> &);
+
+  /**
+   * @brief Removes a reference from the count.
+   *
+   * @param count The shared reference count.
+   * @return bool True if the last reference was removed.
+   */
+  static bool decrement(std::atomic<Count> &);
+
+  /**
+   * @brief Reads the number of references, including spilled ones.
+   *
+   * @param count The shared reference count.
+   * @return std::uint64_t The number of references; a saturated counter
+   * reports its maximum.
+   */
+  static std::uint64_t load(std::atomic<Count> &);
+
+private:
+  static constexpr Count maximum =
+      std::numeric_limits<Count>::max(); ///< Largest representable count.
+  static constexpr bool spills =
+      !Saturating &&
+      sizeof(Count) < sizeof(std::int32_t); ///< Overflows into the table.
+
+  /**
+   * @brief Extra references held by counters stuck at their maximum.
+   */
+  struct OverflowTable {
+    std::mutex mutex; ///< Guards counts and every counter at its maximum.
+    std::unordered_map<const void *, std::uint64_t>
+        counts; ///< References beyond the maximum, keyed by counter address.
+  };
+
+  /**
+   * @brief Retrieves the process-wide overflow table of this counter type.
+   *
+   * @return OverflowTable& The overflow table.
+   */
+  static OverflowTable &overflow_table();
+};
+
+/**
+ * @brief Counter policy used when none is specified; matches a plain
+ * std::atomic<int>.
+ */
+using RefCountedDefaultCounter = RefCountedCounter<int>;
+
+/**
+ * @brief True when an argument pack is a single Self, so that variadic
+ * constructors never take over copies and moves of Self.
+ *
+ * @tparam Self The class whose variadic constructor is being constrained.
+ * @tparam Args The constructor arguments.
+ */
+template <typename Self, typename... Args>
+inline constexpr bool ref_counted_is_self =
+    sizeof...(Args) == 1 &&
+    (std::is_same_v<std::remove_cvref_t<Args>, Self> && ...);
+
+/**
+ * @brief Marks a class as trivially relocatable for compilers that support
+ * the attribute (P1144 Clang), and expands to nothing elsewhere.
+ */
+#if defined(__has_cpp_attribute)
+#if __has_cpp_attribute(clang::trivially_relocatable)
+#define REFCOUNTEDPTR_TRIVIALLY_RELOCATABLE [[clang::trivially_relocatable]]
+#endif
+#endif
+#ifndef REFCOUNTEDPTR_TRIVIALLY_RELOCATABLE
+#define REFCOUNTEDPTR_TRIVIALLY_RELOCATABLE
+#endif
+
+/**
+ * @brief Lets the handle types be passed and returned in registers under
+ * Clang when REFCOUNTEDPTR_ENABLE_TRIVIAL_ABI is defined.
+ *
+ * With [[clang::trivial_abi]] a by-value handle argument is destroyed by the
+ * callee instead of the caller, so it no longer has to live in a stack slot
+ * whose address is passed along. The setting changes the calling convention
+ * and must be the same in every translation unit that shares handles.
+ */
+#if defined(REFCOUNTEDPTR_ENABLE_TRIVIAL_ABI) && defined(__has_cpp_attribute)
+#if __has_cpp_attribute(clang::trivial_abi)
+#define REFCOUNTEDPTR_TRIVIAL_ABI [[clang::trivial_abi]]
+#endif
+#endif
+#ifndef REFCOUNTEDPTR_TRIVIAL_ABI
+#define REFCOUNTEDPTR_TRIVIAL_ABI
+#endif
+
+/**
+ * @brief Trait selecting whether moving a T to a new address and destroying
+ * the source can be done with a plain memory copy.
+ *
+ * True for trivially copyable types and for the handle types of this library,
+ * whose only state is pointers or indices that stay valid at any address.
+ * Specialize it for other types with the same property.
+ *
+ * @tparam T The type to relocate.
+ */
+template <typename T>
+struct ref_counted_is_trivially_relocatable
+    : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+/**
+ * @brief A pair is trivially relocatable when both of its members are.
+ *
+ * @tparam First The type of the first member.
+ * @tparam Second The type of the second member.
+ */
+template <typename First, typename Second>
+struct ref_counted_is_trivially_relocatable<std::pair<First, Second>>
+    : std::bool_constant<
+          ref_counted_is_trivially_relocatable<First>::value &&
+          ref_counted_is_trivially_relocatable<Second>::value> {};
+
+/**
+ * @brief Convenience variable for ref_counted_is_trivially_relocatable.
+ *
+ * @tparam T The type to relocate.
+ */
+template <typename T>
+inline constexpr bool ref_counted_is_trivially_relocatable_v =
+    ref_counted_is_trivially_relocatable<T>::value;
+
+/**
+ * @brief Relocates objects to a new address, ending their lifetime at the
+ * old one.
+ *
+ * Trivially relocatable types are moved with a single memmove, so a vector of
+ * RefCountedPtr grows without touching any reference count. Other types are
+ * move-constructed and destroyed one by one, in an order that is safe when
+ * the two ranges overlap.
+ *
+ * @tparam T The type of the objects.
+ * @param source First object to relocate.
+ * @param count Number of objects to relocate.
+ * @param destination Uninitialized storage for count objects.
+ */
+template <typename T> void ref_counted_relocate(T *, std::size_t, T *);
+
+/**
+ * @brief Copy-constructs an object from a non-const lvalue.
+ *
+ * RefCountedPtr only copies from non-const references, so containers copy
+ * their elements through this function rather than a const copy constructor.
+ *
+ * @tparam T The type of the object.
+ * @param destination Uninitialized storage for the copy.
+ * @param source The object to copy.
+ */
+template <typename T> void ref_counted_copy_construct(T *, T &);
+
+/**
+ * @brief Copy-constructs a pair from a non-const lvalue, member by member.
+ *
+ * std::pair's copy constructor takes a const reference, which a
+ * RefCountedPtr member cannot be copied from, so each member is copied from
+ * the non-const source instead.
+ *
+ * @tparam First The type of the first member.
+ * @tparam Second The type of the second member.
+ * @param destination Uninitialized storage for the copy.
+ * @param source The pair to copy.
+ */
+template <typename First, typename Second>
+void ref_counted_copy_construct(std::pair<First, Second> *,
+                                std::pair<First, Second> &);
+
+/**
+ * @brief Default of whether RefCountedRef counts its borrows, to detect
+ * borrows that outlive the last owner; on unless NDEBUG is defined.
+ *
+ * Every control block holds a borrow count and every last release checks it,
+ * whatever the setting, so the layout is the same in every translation unit.
+ * The setting only picks the default Track argument of RefCountedRef, so a
+ * borrow passed between units built with different settings is a different
+ * type on each side and fails to link instead of miscounting.
+ */
+#ifndef REFCOUNTEDPTR_TRACK_BORROWS
+#ifdef NDEBUG
+#define REFCOUNTEDPTR_TRACK_BORROWS 0
+#else
+#define REFCOUNTEDPTR_TRACK_BORROWS 1
+#endif
+#endif
+
+/**
+ * @brief Type-erased control block shared by all RefCountedPtr instances that
+ * manage the same object.
+ *
+ * Holds the shared reference count and knows how to dispose of the managed
+ * object, so the way an object is released never shows up in the
+ * RefCountedPtr type itself.
+ *
+ * @tparam Counter The reference count policy.
+ */
+template <typename Counter = RefCountedDefaultCounter>
+class RefCountedControlBlock {
+public:
+  union {
+    std::atomic<typename Counter::value_type>
+        shared_references; ///< The shared reference count.
+    typename Counter::value_type
+        constant_references; ///< The count of a block created during
+                             ///< constant evaluation.
+  };
+  std::atomic<std::uint32_t> borrows{0}; ///< Outstanding tracked borrows.
+
+  /**
+   * @brief Constructs a control block with a reference count of zero.
+   *
+   * A block created during constant evaluation counts with a plain integer,
+   * since atomics cannot be modified there.
+   */
+  constexpr RefCountedControlBlock();
+
+  /**
+   * @brief Constructs a control block with the given atomic reference count.
+   *
+   * @param references The initial reference count.
+   */
+  constexpr explicit RefCountedControlBlock(
+      typename Counter::value_type references)
+      : shared_references(references) {}
+
+  /**
+   * @brief Aborts if a tracked RefCountedRef still borrows the object.
+   *
+   * Called right before the object is released; borrows that are not
+   * tracked are never counted and cannot trigger it.
+   */
+  constexpr void check_borrows();
+
+  /**
+   * @brief Adds a reference to the count.
+   */
+  constexpr void add_reference();
+
+  /**
+   * @brief Removes a reference from the count.
+   *
+   * @return bool True if the last reference was removed.
+   */
+  constexpr bool remove_reference();
+
+  /**
+   * @brief Blocks until the reference count equals the given value.
+   *
+   * The caller must hold a reference, so the count can only drop towards the
+   * target while it waits.
+   *
+   * @param target The count to wait for.
+   */
+  void wait_for_count(typename Counter::value_type);
+
+  /**
+   * @brief Wakes threads blocked in wait_for_count after a reference has
+   * been dropped.
+   *
+   * Only reads a process-wide waiter count unless some thread is waiting,
+   * and touches no memory of the control block, so it is safe to call after
+   * the caller's reference is gone.
+   */
+  static void notify_release();
+
+  /**
+   * @brief Destroys the managed object and the control block itself.
+   *
+   * Called exactly once, when the last reference has been released.
+   */
+  virtual constexpr void release_data() = 0;
+
+  /**
+   * @brief Retrieves the std::shared_ptr keeping the object alive, for blocks
+   * created from one.
+   *
+   * @return std::shared_ptr<const void> The owning std::shared_ptr, or an
+   * empty one if the object is not owned by a std::shared_ptr.
+   */
+  virtual std::shared_ptr<const void> get_shared_owner();
+
+  /**
+   * @brief Checks whether owners outside the reference count, such as
+   * std::shared_ptr instances, still share the object.
+   *
+   * @return bool True if the object is not owned by its RefCountedPtr
+   * instances alone.
+   */
+  virtual bool has_external_owners();
+
+  /**
+   * @brief Checks whether the object is never released, whatever happens to
+   * the reference count.
+   *
+   * @return bool True for objects in static storage.
+   */
+  virtual bool is_immortal();
+
+protected:
+  constexpr virtual ~RefCountedControlBlock() = default;
+
+private:
+  /**
+   * @brief Process-wide state of threads blocked in wait_for_count.
+   */
+  struct Waiters {
+    std::atomic<std::uint32_t> count{0}; ///< Number of blocked threads.
+    std::atomic<std::uint32_t> epoch{0}; ///< Bumped by every notification.
+  };
+
+  /**
+   * @brief Retrieves the waiter state of this counter type.
+   *
+   * @return Waiters& The waiter state.
+   */
+  static Waiters &waiters();
+};
+
+/**
+ * @brief Control block for an object owned through a raw pointer and a
+ * deleter.
+ *
+ * The deleter is stored with [[no_unique_address]], so stateless deleters such
+ * as std::default_delete or captureless lambdas add no storage to the block.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Deleter Callable invoked with the raw pointer on release.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Deleter,
+          typename Counter = RefCountedDefaultCounter>
+class RefCountedPointerBlock : public RefCountedControlBlock<Counter> {
+private:
+  T *data;                               ///< Pointer to the managed object.
+  [[no_unique_address]] Deleter deleter; ///< Disposes of the managed object.
+
+public:
+  /**
+   * @brief Constructs a control block owning the given pointer.
+   *
+   * @param data The raw pointer to manage.
+   * @param deleter The deleter used to dispose of data.
+   */
+  constexpr RefCountedPointerBlock(T *, Deleter);
+
+  /**
+   * @brief Destroys the block; declared explicitly so that GCC can run it
+   * during constant evaluation.
+   */
+  constexpr ~RefCountedPointerBlock() override = default;
+
+  /**
+   * @brief Invokes the deleter on the managed object and frees the block.
+   */
+  constexpr void release_data() override;
+};
+
+/**
+ * @brief Alignment of a control block that stores a T inline.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Layout The memory layout of the block.
+ */
+template <typename T, RefCountedLayout Layout>
+inline constexpr std::size_t ref_counted_inplace_block_alignment =
+    std::max({alignof(RefCountedControlBlock<>),
+              ref_counted_inplace_alignment<T>,
+              Layout == RefCountedLayout::Isolated ? ref_counted_cache_line_size
+                                                   : std::size_t(1)});
+
+/**
+ * @brief Control block that stores the managed object inline.
+ *
+ * Used by the variadic constructor so the object and its reference count
+ * share a single allocation and are released with a single delete. The object
+ * keeps its own alignment, and is moved to the next cache line when
+ * ref_counted_isolate_counter<T> asks for it, so count updates never contend
+ * with the object's hot fields.
+ *
+ * With RefCountedLayout::Isolated the whole block is aligned to and padded out
+ * to full cache lines, so copies of unrelated objects allocated side by side
+ * never invalidate each other's counters. RefCountedLayout::Packed keeps the
+ * block as small as possible for large numbers of cold objects.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Layout The memory layout of the block.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, RefCountedLayout Layout = RefCountedLayout::Packed,
+          typename Counter = RefCountedDefaultCounter>
+class alignas(ref_counted_inplace_block_alignment<T, Layout>)
+    RefCountedInplaceBlock : public RefCountedControlBlock<Counter> {
+private:
+  alignas(ref_counted_inplace_alignment<T>) T data; ///< The managed object.
+
+public:
+  /**
+   * @brief Constructs the managed object in place.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param args Arguments to pass to the T constructor.
+   */
+  template <typename... Args> RefCountedInplaceBlock(Args &&...);
+
+  /**
+   * @brief Retrieves a pointer to the inline object.
+   *
+   * @return T* Pointer to the managed object.
+   */
+  T *get_data();
+
+  /**
+   * @brief Destroys the inline object together with the block.
+   */
+  void release_data() override;
+};
+
+/**
+ * @brief Control block fused with the elements of a shared array.
+ *
+ * A single allocation holds the block (reference count and length) followed by
+ * the elements, which start at the requested alignment (never below
+ * alignof(T)). Created through make_ref_counted_array.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter = RefCountedDefaultCounter>
+class RefCountedArrayBlock : public RefCountedControlBlock<Counter> {
+private:
+  std::size_t length;    ///< Number of elements following the block.
+  std::size_t alignment; ///< Alignment of the allocation and its elements.
+
+  /**
+   * @brief Constructs the block header for an already constructed array.
+   *
+   * @param length Number of elements following the block.
+   * @param alignment Alignment the allocation was made with.
+   */
+  RefCountedArrayBlock(std::size_t, std::size_t);
+
+  /**
+   * @brief Computes the offset of the first element from the block start.
+   *
+   * @param alignment Alignment of the allocation and its elements.
+   * @return std::size_t Offset rounded up to a multiple of alignment.
+   */
+  static std::size_t elements_offset(std::size_t);
+
+public:
+  /**
+   * @brief Allocates a block and its elements in a single allocation.
+   *
+   * Elements are value-initialized, or copy-initialized from the given value.
+   * If an element constructor throws, the constructed elements are destroyed
+   * and the allocation is freed before the exception propagates.
+   *
+   * @tparam Args Either empty or a single value to copy into every element.
+   * @param length Number of elements to allocate.
+   * @param alignment Minimum alignment of the first element.
+   * @param args Optional value to initialize the elements with.
+   * @return RefCountedArrayBlock<T, Counter>* The new block, with a reference
+   * count of zero.
+   */
+  template <typename... Args>
+  static RefCountedArrayBlock<T, Counter> *create(std::size_t, std::size_t,
+                                                  const Args &...);
+
+  /**
+   * @brief Retrieves a pointer to the first element.
+   *
+   * @return T* Pointer to the first element.
+   */
+  T *get_data();
+
+  /**
+   * @brief Retrieves the number of elements in the array.
+   *
+   * @return std::size_t The number of elements.
+   */
+  std::size_t get_length();
+
+  /**
+   * @brief Destroys the elements and frees the whole allocation.
+   */
+  void release_data() override;
+};
+
+template <typename T, typename Counter> class RefCountedPtr;
+template <typename T, typename Counter> class RefCountedUniquePtr;
+
+/**
+ * @brief Mixin that lets an object obtain a RefCountedPtr to itself.
+ *
+ * Derive T from EnableRefCountedFromThis<T, Counter>; every RefCountedPtr,
+ * RefCountedHandle or promoted RefCountedUniquePtr that creates a control
+ * block for the object stores a link to that block in the mixin, and
+ * ref_from_this() shares it with a single increment instead of allocating a
+ * second, independent count. The link owns nothing, so ref_from_this() may
+ * only be called while the object is owned.
+ *
+ * @tparam T The derived type.
+ * @tparam Counter The reference count policy of the owning pointers.
+ */
+template <typename T, typename Counter = RefCountedDefaultCounter>
+class EnableRefCountedFromThis {
+private:
+  RefCountedControlBlock<Counter>
+      *self_control_block; ///< Control block owning this object, if any.
+
+  template <typename U, typename C>
+  friend constexpr std::true_type
+  ref_counted_link_self(EnableRefCountedFromThis<U, C> *,
+                        RefCountedControlBlock<C> *);
+
+protected:
+  /**
+   * @brief Constructs an object that is not owned yet.
+   */
+  constexpr EnableRefCountedFromThis() : self_control_block(nullptr) {}
+
+  /**
+   * @brief Copy constructor; the copy is a new object and is not owned yet.
+   *
+   * @param other The object being copied.
+   */
+  constexpr EnableRefCountedFromThis(
+      const EnableRefCountedFromThis<T, Counter> &)
+      : self_control_block(nullptr) {}
+
+  /**
+   * @brief Assignment operator that keeps this object's own link.
+   *
+   * @param other The object being assigned from.
+   * @return EnableRefCountedFromThis<T, Counter>& Reference to this object.
+   */
+  EnableRefCountedFromThis<T, Counter> &
+  operator=(const EnableRefCountedFromThis<T, Counter> &) {
+    return *this;
+  }
+
+  ~EnableRefCountedFromThis() = default;
+
+public:
+  /**
+   * @brief Creates a RefCountedPtr sharing the control block that owns this
+   * object.
+   *
+   * @return RefCountedPtr<T, Counter> Pointer sharing ownership of this
+   * object, or an empty pointer if it is not owned by a control block.
+   */
+  RefCountedPtr<T, Counter> ref_from_this();
+};
+
+/**
+ * @brief Links an object derived from EnableRefCountedFromThis to the control
+ * block that owns it.
+ *
+ * @tparam U The type passed to the mixin.
+ * @tparam Counter The reference count policy.
+ * @param object The object, or nullptr.
+ * @param control_block The control block owning the object.
+ * @return std::true_type Marks types that need the link.
+ */
+template <typename U, typename Counter>
+constexpr std::true_type
+ref_counted_link_self(EnableRefCountedFromThis<U, Counter> *,
+                      RefCountedControlBlock<Counter> *);
+
+/**
+ * @brief Fallback for objects that do not use EnableRefCountedFromThis.
+ *
+ * @tparam Counter The reference count policy.
+ * @param object The object.
+ * @param control_block The control block owning the object.
+ * @return std::false_type Marks types that need no link.
+ */
+template <typename Counter>
+constexpr std::false_type
+ref_counted_link_self(const volatile void *,
+                      RefCountedControlBlock<Counter> *);
+
+/**
+ * @brief Control block for an immortal object in static storage.
+ *
+ * The object is stored inline and both are constant-initialized, so a
+ * constinit global block and every constinit RefCountedPtr wrapping it cost
+ * nothing at load time. The count starts at half its range, far above
+ * anything the pointers made from it can use up, so the object always
+ * reports being shared and is never released. The object sits in a union, so
+ * its destructor never runs, not even at program exit.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter = RefCountedDefaultCounter>
+class RefCountedStaticBlock : public RefCountedControlBlock<Counter> {
+private:
+  union {
+    T data; ///< The managed object, never destroyed.
+  };
+
+public:
+  /**
+   * @brief Reference count of a block that has never been shared.
+   */
+  static constexpr typename Counter::value_type immortal_references =
+      std::numeric_limits<typename Counter::value_type>::max() / 2;
+
+  /**
+   * @brief Constructs the object in place, at compile time when possible.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param args Arguments to pass to the T constructor.
+   */
+  template <typename... Args>
+  constexpr explicit RefCountedStaticBlock(Args &&...args)
+      : RefCountedControlBlock<Counter>(immortal_references),
+        data(std::forward<Args>(args)...) {
+    ref_counted_link_self(&data, this);
+  }
+
+  /**
+   * @brief Leaves the object alive, so it stays usable from destructors of
+   * other statics that run after this block's.
+   */
+  constexpr ~RefCountedStaticBlock() override {}
+
+  /**
+   * @brief Retrieves the managed object.
+   *
+   * @return T* Pointer to the object.
+   */
+  constexpr T *get_data() { return &data; }
+
+  /**
+   * @brief Does nothing; the object lives as long as the program.
+   */
+  void release_data() override {}
+
+  /**
+   * @brief Reports the object as never released.
+   *
+   * @return bool Always true.
+   */
+  bool is_immortal() override { return true; }
+};
+
+/**
+ * @brief Control block built together with its object inside storage owned
+ * by the caller.
+ *
+ * Used for objects that live in preallocated buffers such as ring slots or
+ * mapped regions: the block and the object are constructed at the start of
+ * the given storage, and instead of deleting anything, the last release
+ * destroys both and hands the storage back through the release callback. The
+ * heap allocator is never involved. Created through make_ref_counted_in.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Release Callable invoked with the storage address after the object
+ * has been destroyed.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Release,
+          typename Counter = RefCountedDefaultCounter>
+class RefCountedPlacementBlock : public RefCountedControlBlock<Counter> {
+private:
+  [[no_unique_address]] Release release; ///< Returns the storage.
+  T data;                                ///< The managed object.
+
+  /**
+   * @brief Constructs the object in place.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param release Callable returning the storage.
+   * @param args Arguments to pass to the T constructor.
+   */
+  template <typename... Args> RefCountedPlacementBlock(Release, Args &&...);
+
+public:
+  /**
+   * @brief Constructs a block and its object at the start of the given
+   * storage.
+   *
+   * Throws std::bad_alloc if the storage is too small or misaligned. If the
+   * T constructor throws, the storage still belongs to the caller and the
+   * release callback is not invoked.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param storage Start of the storage, aligned to at least
+   * alignof(RefCountedPlacementBlock).
+   * @param size Size of the storage in bytes, at least
+   * sizeof(RefCountedPlacementBlock).
+   * @param release Callable invoked with storage once the object is released.
+   * @param args Arguments to pass to the T constructor.
+   * @return RefCountedPlacementBlock<T, Release, Counter>* The new block,
+   * with a reference count of zero.
+   */
+  template <typename... Args>
+  static RefCountedPlacementBlock<T, Release, Counter> *
+  create(void *, std::size_t, Release, Args &&...);
+
+  /**
+   * @brief Retrieves the managed object.
+   *
+   * @return T* Pointer to the object.
+   */
+  T *get_data();
+
+  /**
+   * @brief Destroys the object and the block, then hands the storage back.
+   */
+  void release_data() override;
+};
+
+/**
+ * @brief Control block for an object owned by a std::shared_ptr.
+ *
+ * Keeps the std::shared_ptr alive for as long as any RefCountedPtr refers to
+ * the object, so converting needs neither a copy of the object nor a
+ * wrapper around it. Created through RefCountedPtr::from_shared.
+ *
+ * @tparam Counter The reference count policy.
+ */
+template <typename Counter = RefCountedDefaultCounter>
+class RefCountedSharedBlock : public RefCountedControlBlock<Counter> {
+private:
+  std::shared_ptr<const void> owner; ///< Keeps the object alive.
+
+public:
+  /**
+   * @brief Constructs a block keeping the given owner alive.
+   *
+   * @param owner The std::shared_ptr owning the object.
+   */
+  explicit RefCountedSharedBlock(std::shared_ptr<const void>);
+
+  /**
+   * @brief Retrieves the std::shared_ptr keeping the object alive.
+   *
+   * @return std::shared_ptr<const void> The owning std::shared_ptr.
+   */
+  std::shared_ptr<const void> get_shared_owner() override;
+
+  /**
+   * @brief Checks whether other std::shared_ptr instances share the object.
+   *
+   * @return bool True if the held std::shared_ptr is not the only one.
+   */
+  bool has_external_owners() override;
+
+  /**
+   * @brief Drops the std::shared_ptr and frees the block.
+   */
+  void release_data() override;
+};
+
+/**
+ * @brief Control block of a lazily owned object converted to a
+ * std::shared_ptr, fused with the control block of that std::shared_ptr.
+ *
+ * The block is the deleter of the std::shared_ptr, which stores it inside its
+ * own control block, so both live in a single allocation. While any
+ * RefCountedPtr refers to the block, the block holds a std::shared_ptr to the
+ * object, and every later to_shared hands out that same owner. The object is
+ * deleted together with the last std::shared_ptr. Created through
+ * RefCountedPtr::to_shared.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter = RefCountedDefaultCounter>
+class RefCountedBridgeBlock : public RefCountedControlBlock<Counter> {
+private:
+  T *data; ///< The object, or nullptr until adopt has run.
+  std::shared_ptr<const void>
+      owner; ///< Keeps the object alive while the block is referenced.
+
+public:
+  /**
+   * @brief Constructs a block that owns nothing yet.
+   */
+  RefCountedBridgeBlock();
+
+  /**
+   * @brief Move constructor used while the std::shared_ptr stores the block.
+   *
+   * Blocks are only moved before adopt, so the new block owns nothing either.
+   *
+   * @param other The block to move from.
+   */
+  RefCountedBridgeBlock(RefCountedBridgeBlock<T, Counter> &&);
+
+  /**
+   * @brief Takes over a lazily owned object and the std::shared_ptr storing
+   * this block, and adds the reference of the converting RefCountedPtr.
+   *
+   * @param shared The std::shared_ptr whose deleter is this block.
+   */
+  void adopt(std::shared_ptr<T> &);
+
+  /**
+   * @brief Adds a reference unless the count has already dropped to zero.
+   *
+   * @return bool True if a reference was added.
+   */
+  bool try_add_reference();
+
+  /**
+   * @brief Retrieves the std::shared_ptr keeping the object alive.
+   *
+   * @return std::shared_ptr<const void> The owner shared by every to_shared.
+   */
+  std::shared_ptr<const void> get_shared_owner() override;
+
+  /**
+   * @brief Checks whether std::shared_ptr instances from to_shared are still
+   * alive.
+   *
+   * @return bool True if the held std::shared_ptr is not the only one.
+   */
+  bool has_external_owners() override;
+
+  /**
+   * @brief Drops the std::shared_ptr held for the RefCountedPtr instances.
+   */
+  void release_data() override;
+
+  /**
+   * @brief Deletes the object once the last std::shared_ptr is gone.
+   *
+   * @param data The pointer the std::shared_ptr was created with.
+   */
+  void operator()(T *);
+};
 
 /**
  * @brief A custom shared pointer class for managing shared ownership of
  * objects.
  *
- * RefCountedPtr enables multiple pointers to share ownership of a dynamically
- * allocated object, automatically deleting it when the last reference is
- * destroyed.
+ * RefCountedPtr enables multiple pointers to share ownership of a dynamically
+ * allocated object, automatically deleting it when the last reference is
+ * destroyed.
+ *
+ * The width and overflow behaviour of the shared count are chosen with the
+ * Counter policy, for example RefCountedCounter<std::int64_t> for massive
+ * fan-out or RefCountedCounter<std::uint16_t> for tiny objects.
+ *
+ * @tparam T The type of the object being managed.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter = RefCountedDefaultCounter>
+class REFCOUNTEDPTR_TRIVIALLY_RELOCATABLE REFCOUNTEDPTR_TRIVIAL_ABI
+    RefCountedPtr {
+private:
+  T *data; ///< Pointer to the managed object.
+  RefCountedControlBlock<Counter>
+      *control_block; ///< Pointer to the shared control block.
+
+  /**
+   * @brief Initializes the pointer with the given data and control block.
+   *
+   * Configures the data pointer and links it to a shared control block,
+   * incrementing its reference count to track ownership.
+   *
+   * @param data Pointer to the object to manage.
+   * @param control_block Pointer to the shared control block.
+   */
+  constexpr void init_data(T *, RefCountedControlBlock<Counter> *);
+
+  /**
+   * @brief Releases the managed object and its control block.
+   *
+   * Hands the object back to the control block, which disposes of it with the
+   * deleter chosen at construction.
+   */
+  constexpr void release_data();
+
+  /**
+   * @brief Drops this pointer's reference, releasing the object if it was
+   * the last one.
+   */
+  constexpr void release_reference();
+
+  /**
+   * @brief Allocates the control block of a lazily owned object.
+   *
+   * Does nothing if the pointer is empty or already has a control block.
+   */
+  constexpr void share();
+
+  template <typename, typename> friend class RefCountedPtr;
+  template <typename, typename> friend class RefCountedHandle;
+  template <typename, typename> friend class RefCountedUniquePtr;
+  template <typename, typename> friend class EnableRefCountedFromThis;
+  template <typename, typename, bool> friend class RefCountedRef;
+  template <typename, typename, typename> friend class LazyRefCountedPtr;
+
+public:
+  /**
+   * @brief Default constructor creating an empty RefCountedPtr.
+   *
+   * Initializes data and control_block to nullptr, representing no
+   * ownership.
+   */
+  constexpr RefCountedPtr() : data(nullptr), control_block(nullptr) {}
+
+  /**
+   * @brief Constructs an empty RefCountedPtr from nullptr.
+   */
+  constexpr RefCountedPtr(std::nullptr_t) : RefCountedPtr() {}
+
+  /**
+   * @brief Wraps an immortal object in static storage.
+   *
+   * Constant-evaluated when used to initialize a constinit global; the
+   * reference count is only touched when called at run time.
+   *
+   * @param block The static block holding the object.
+   */
+  constexpr RefCountedPtr(RefCountedStaticBlock<T, Counter> &);
+
+  /**
+   * @brief Constructs a RefCountedPtr from a block built in caller-provided
+   * storage.
+   *
+   * Assumes ownership of the block and sets the reference count to 1.
+   *
+   * @tparam Release Callable returning the storage.
+   * @param control_block The placement block to manage.
+   */
+  template <typename Release>
+  explicit RefCountedPtr(RefCountedPlacementBlock<T, Release, Counter> *);
+
+  /**
+   * @brief Constructs a RefCountedPtr from a raw pointer.
+   *
+   * Assumes ownership of the raw pointer and sets the reference count to 1.
+   *
+   * @param data The raw pointer to manage.
+   */
+  constexpr RefCountedPtr(T *);
+
+  /**
+   * @brief Constructs a RefCountedPtr from a raw pointer and a custom deleter.
+   *
+   * Assumes ownership of the raw pointer and sets the reference count to 1.
+   * The deleter is stored in the control block, so RefCountedPtr<T> keeps the
+   * same type regardless of the deleter used.
+   *
+   * @tparam Deleter Callable invoked with the raw pointer on release.
+   * @param data The raw pointer to manage.
+   * @param deleter The deleter used to dispose of data.
+   */
+  template <typename Deleter> constexpr RefCountedPtr(T *, Deleter);
+
+  /**
+   * @brief Constructs a RefCountedPtr from a raw pointer without allocating a
+   * control block.
+   *
+   * The object is held with an implicit reference count of 1, and the
+   * control block is only allocated by the first copy, so objects that are
+   * never shared cost no allocation beyond their own. Until that first copy
+   * the pointer must not be copied from several threads at once. The object
+   * is disposed of with delete. Objects derived from EnableRefCountedFromThis
+   * need their control block right away, so it is allocated eagerly. Not
+   * available for RefCountedPtr<void>, which could not delete the object.
+   *
+   * @param lazy Tag selecting lazy allocation.
+   * @param data The raw pointer to manage.
+   */
+  RefCountedPtr(RefCountedLazyTag, T *);
+
+  /**
+   * @brief Aliasing constructor sharing ownership with another pointer.
+   *
+   * Points at data, typically a member of the owner's object or an element
+   * of its array, while sharing the owner's reference count, so the whole
+   * owner stays alive as long as this pointer does. No allocation is made.
+   * If owner is empty, the result is empty as well.
+   *
+   * @tparam U The type managed by the owner.
+   * @param owner The pointer whose ownership is shared.
+   * @param data The object this pointer refers to.
+   */
+  template <typename U> RefCountedPtr(RefCountedPtr<U, Counter> &, T *);
+
+  /**
+   * @brief Aliasing constructor taking over ownership from another pointer.
+   *
+   * Like the sharing aliasing constructor, but the owner's reference moves
+   * into this pointer without touching the count, leaving owner empty.
+   *
+   * @tparam U The type managed by the owner.
+   * @param owner The pointer to take ownership from.
+   * @param data The object this pointer refers to.
+   */
+  template <typename U> RefCountedPtr(RefCountedPtr<U, Counter> &&, T *);
+
+  /**
+   * @brief Converting constructor sharing ownership with a pointer to a
+   * derived type.
+   *
+   * Shares the existing control block; the object pointer is adjusted as
+   * required by the conversion, including for multiple inheritance.
+   *
+   * @tparam U A type whose pointer converts implicitly to T*.
+   * @param other The RefCountedPtr to share ownership with.
+   */
+  template <typename U>
+    requires(std::is_convertible_v<U *, T *> && !std::is_same_v<U, T>)
+  RefCountedPtr(RefCountedPtr<U, Counter> &);
+
+  /**
+   * @brief Converting constructor taking over ownership from a pointer to a
+   * derived type without touching the reference count.
+   *
+   * @tparam U A type whose pointer converts implicitly to T*.
+   * @param other The RefCountedPtr to take ownership from; left empty.
+   */
+  template <typename U>
+    requires(std::is_convertible_v<U *, T *> && !std::is_same_v<U, T>)
+  RefCountedPtr(RefCountedPtr<U, Counter> &&);
+
+  /**
+   * @brief Constructs a RefCountedPtr with variadic arguments.
+   *
+   * Allocates a new object of T with the given arguments and sets the
+   * reference count to 1. The object and its control block share a single
+   * allocation.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param args Arguments to pass to the T constructor.
+   */
+  template <typename... Args>
+    requires(!ref_counted_is_self<RefCountedPtr<T, Counter>, Args...>)
+  constexpr RefCountedPtr(Args &&...args);
+
+  /**
+   * @brief Constructs a RefCountedPtr with a chosen control block layout.
+   *
+   * Like the variadic constructor, but places the object in a control block
+   * with the layout selected by the tag (ref_counted_packed or
+   * ref_counted_isolated).
+   *
+   * @tparam Layout The memory layout of the control block.
+   * @tparam Args Variadic template for constructor arguments.
+   * @param layout Tag selecting the layout.
+   * @param args Arguments to pass to the T constructor.
+   */
+  template <RefCountedLayout Layout, typename... Args>
+  constexpr RefCountedPtr(RefCountedLayoutTag<Layout>, Args &&...args);
+
+  /**
+   * @brief Copy constructor for sharing ownership.
+   *
+   * Shares the managed object and reference count with another RefCountedPtr,
+   * incrementing the count.
+   *
+   * @param other The RefCountedPtr to share ownership with.
+   */
+  constexpr RefCountedPtr(RefCountedPtr<T, Counter> &);
+
+  /**
+   * @brief Move constructor transferring ownership.
+   *
+   * Takes over the managed object and control block of another RefCountedPtr,
+   * leaving it empty. The reference count is not touched.
+   *
+   * @param other The RefCountedPtr to take ownership from.
+   */
+  constexpr RefCountedPtr(RefCountedPtr<T, Counter> &&) noexcept;
+
+  /**
+   * @brief Destructor that cleans up resources.
+   *
+   * Decrements the reference count and releases resources if it reaches zero.
+   */
+  constexpr ~RefCountedPtr();
+
+  /**
+   * @brief Retrieves the raw pointer to the managed object.
+   *
+   * Returns the underlying pointer, or nullptr if no object is managed.
+   *
+   * @return T* The raw pointer to the managed object.
+   */
+  constexpr T *get_data();
+
+  /**
+   * @brief Assignment operator for sharing ownership.
+   *
+   * Releases current resources (if any) and shares ownership with another
+   * RefCountedPtr, adjusting reference counts accordingly.
+   *
+   * @param other The RefCountedPtr to assign from.
+   * @return RefCountedPtr<T, Counter>& Reference to this RefCountedPtr.
+   */
+  constexpr RefCountedPtr<T, Counter> &
+  operator=(RefCountedPtr<T, Counter> &);
+
+  /**
+   * @brief Move assignment operator transferring ownership.
+   *
+   * Releases current resources (if any) and takes over those of another
+   * RefCountedPtr, leaving it empty.
+   *
+   * @param other The RefCountedPtr to take ownership from.
+   * @return RefCountedPtr<T, Counter>& Reference to this RefCountedPtr.
+   */
+  constexpr RefCountedPtr<T, Counter> &
+  operator=(RefCountedPtr<T, Counter> &&) noexcept;
+
+  /**
+   * @brief Takes back unique ownership if this is the only reference.
+   *
+   * On success this pointer is left empty and the control block is kept for
+   * a later promotion; otherwise nothing changes. An object still owned by a
+   * std::shared_ptr is never unique. ref_from_this() returns an
+   * empty pointer while the object is uniquely owned.
+   *
+   * @return RefCountedUniquePtr<T, Counter> The object, or an empty pointer
+   * if it is shared.
+   */
+  RefCountedUniquePtr<T, Counter> try_unique();
+
+  /**
+   * @brief Retrieves the number of pointers sharing the managed object.
+   *
+   * The count is read with acquire ordering, so a result of 1 also makes
+   * every write done through references that have since been released
+   * visible to this thread.
+   *
+   * @return std::size_t The number of owners, or 0 if no object is managed.
+   */
+  std::size_t use_count();
+
+  /**
+   * @brief Checks whether this is the only pointer to the managed object.
+   *
+   * Costs a single acquire load of the count, or nothing for a lazily owned
+   * object. A count of 1 on a block created by from_shared or to_shared
+   * additionally asks the block whether a std::shared_ptr still shares it.
+   *
+   * @return bool True if an object is managed and no other pointer shares it.
+   */
+  bool is_unique();
+
+  /**
+   * @brief Prepares the managed object for modification (copy on write).
+   *
+   * If the object is shared, including with a std::shared_ptr, it is
+   * copy-constructed into a new allocation that this pointer then owns alone;
+   * other owners keep the original. A type that defines a member
+   * ref_counted_clone() returning a pointer convertible to this one is
+   * cloned through it instead, which lets polymorphic objects keep their
+   * dynamic type. Otherwise, throws std::bad_cast if T is polymorphic and
+   * the object is of a derived type that a copy would slice.
+   *
+   * @return T* The object, now owned only by this pointer, or nullptr if no
+   * object is managed.
+   */
+  T *make_mutable();
+
+  /**
+   * @brief Blocks until this is the only pointer to the managed object.
+   *
+   * Returns immediately for an empty or lazily owned pointer. An object in a
+   * RefCountedStaticBlock is never unique, so this aborts for it in debug
+   * builds and never returns otherwise; a saturated count never drops
+   * either. std::shared_ptr owners cannot notify, so once the count has
+   * dropped to 1 their release is polled.
+   */
+  void wait_until_unique();
+
+  /**
+   * @brief Blocks until every other pointer has dropped the managed object,
+   * then releases it on this thread.
+   *
+   * On return the object has been destroyed and this pointer is empty. An
+   * object in a RefCountedStaticBlock is never destroyed, so for it this
+   * only drops the reference and returns without waiting.
+   */
+  void wait_until_released();
+
+  /**
+   * @brief Converts to a std::shared_ptr sharing ownership of the object.
+   *
+   * An object that came from a std::shared_ptr is handed back to it without
+   * allocating. A lazily owned object gets a RefCountedBridgeBlock, one
+   * allocation serving as both control blocks, and every later call on any
+   * of its pointers returns the same owner without allocating.
+   *
+   * Any other control block has no room to remember a std::shared_ptr, so
+   * each call allocates a new std::shared_ptr control block whose deleter
+   * holds a reference through RefCountedSharedDeleter, and the results are
+   * distinct owners under owner_before. Convert once and copy the result
+   * when the object is handed to std::shared_ptr code repeatedly.
+   *
+   * @return std::shared_ptr<T> Pointer to the object, or an empty one if no
+   * object is managed.
+   */
+  std::shared_ptr<T> to_shared();
+
+  /**
+   * @brief Converts a std::shared_ptr to a RefCountedPtr sharing ownership
+   * of its object.
+   *
+   * A std::shared_ptr created by to_shared is converted back without
+   * allocating; otherwise one RefCountedSharedBlock is allocated to keep the
+   * std::shared_ptr alive. The object itself is never copied.
+   *
+   * @param shared The std::shared_ptr to share ownership with.
+   * @return RefCountedPtr<T, Counter> Pointer to the object, or an empty one
+   * if shared holds nullptr.
+   */
+  static RefCountedPtr<T, Counter> from_shared(std::shared_ptr<T>);
+};
+
+/**
+ * @brief std::shared_ptr deleter that holds a reference to an object owned
+ * by RefCountedPtr.
+ *
+ * Used by RefCountedPtr::to_shared; the object is released through its own
+ * control block once both the std::shared_ptr and every RefCountedPtr are
+ * gone. RefCountedPtr::from_shared looks for this deleter to convert back
+ * without allocating.
+ *
+ * @tparam Counter The reference count policy.
+ */
+template <typename Counter = RefCountedDefaultCounter>
+struct RefCountedSharedDeleter {
+  RefCountedPtr<const void, Counter> owner; ///< Reference to the object.
+
+  /**
+   * @brief Drops the reference held by the deleter.
+   *
+   * @param data The pointer the std::shared_ptr was created with.
+   */
+  void operator()(const volatile void *);
+};
+
+/**
+ * @brief RefCountedPtr specialization for shared arrays.
+ *
+ * The reference count, the length and the elements live in one allocation,
+ * so indexing the array needs no additional pointer chase. Instances are
+ * created with make_ref_counted_array.
  *
- * @tparam T The type of the object being managed.
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
  */
-template <typename T> class RefCountedPtr {
+template <typename T, typename Counter>
+class REFCOUNTEDPTR_TRIVIALLY_RELOCATABLE REFCOUNTEDPTR_TRIVIAL_ABI
+    RefCountedPtr<T[], Counter> {
 private:
-  T *data; ///< Pointer to the managed object.
-  std::atomic<int>
-      *shared_references; ///< Pointer to the shared reference count.
+  T *data; ///< Pointer to the first element.
+  RefCountedArrayBlock<T, Counter>
+      *control_block; ///< Pointer to the fused array block.
 
   /**
-   * @brief Initializes the pointer with the given data and reference count.
+   * @brief Initializes the pointer with the given elements and array block.
    *
-   * Configures the data pointer and links it to a shared reference count,
-   * incrementing the count to track ownership.
-   *
-   * @param data Pointer to the object to manage.
-   * @param shared_references Pointer to the atomic reference count.
+   * @param data Pointer to the first element.
+   * @param control_block Pointer to the fused array block.
    */
-  virtual void init_data(T *, std::atomic<int> *);
+  void init_data(T *, RefCountedArrayBlock<T, Counter> *);
 
   /**
-   * @brief Releases the managed object and its reference count.
-   *
-   * Deletes the managed object and reference count when no references remain.
+   * @brief Releases the elements and their array block.
+   */
+  void release_data();
+
+  /**
+   * @brief Drops this pointer's reference, releasing the array if it was the
+   * last one and waking waiting threads otherwise.
    */
-  virtual void release_data();
+  void release_reference();
+
+  template <typename, typename> friend class RefCountedPtr;
 
 public:
   /**
    * @brief Default constructor creating an empty RefCountedPtr.
+   */
+  constexpr RefCountedPtr() : data(nullptr), control_block(nullptr) {}
+
+  /**
+   * @brief Constructs an empty RefCountedPtr from nullptr.
+   */
+  constexpr RefCountedPtr(std::nullptr_t) : RefCountedPtr() {}
+
+  /**
+   * @brief Constructs a RefCountedPtr from a freshly created array block.
    *
-   * Initializes data and shared_references to nullptr, representing no
-   * ownership.
+   * Assumes ownership of the block and sets the reference count to 1.
+   *
+   * @param control_block The array block to manage.
    */
-  RefCountedPtr() : data(nullptr), shared_references(nullptr) {}
+  explicit RefCountedPtr(RefCountedArrayBlock<T, Counter> *);
 
   /**
-   * @brief Constructs a RefCountedPtr from a raw pointer.
+   * @brief Copy constructor for sharing ownership of the array.
    *
-   * Assumes ownership of the raw pointer and sets the reference count to 1.
+   * @param other The RefCountedPtr to share ownership with.
+   */
+  RefCountedPtr(RefCountedPtr<T[], Counter> &);
+
+  /**
+   * @brief Move constructor transferring ownership of the array.
    *
-   * @param data The raw pointer to manage.
+   * @param other The RefCountedPtr to take ownership from; left empty.
    */
-  RefCountedPtr(T *);
+  RefCountedPtr(RefCountedPtr<T[], Counter> &&) noexcept;
 
   /**
-   * @brief Constructs a RefCountedPtr with variadic arguments.
+   * @brief Destructor that releases the array when no references remain.
+   */
+  ~RefCountedPtr();
+
+  /**
+   * @brief Retrieves the pointer to the first element.
    *
-   * Allocates a new object of T with the given arguments and sets the
-   * reference count to 1.
+   * @return T* The first element, or nullptr if no array is managed.
+   */
+  T *get_data();
+
+  /**
+   * @brief Retrieves the number of elements in the managed array.
+   *
+   * @return std::size_t The number of elements, or 0 if no array is managed.
+   */
+  std::size_t get_length();
+
+  /**
+   * @brief Retrieves a span over the managed elements.
+   *
+   * @return std::span<T> Span covering every element of the array.
+   */
+  std::span<T> get_span();
+
+  /**
+   * @brief Accesses an element without bounds checking.
+   *
+   * @param index Index of the element.
+   * @return T& Reference to the element.
+   */
+  T &operator[](std::size_t);
+
+  /**
+   * @brief Retrieves the number of pointers sharing the managed array.
+   *
+   * @return std::size_t The number of owners, or 0 if no array is managed.
+   */
+  std::size_t use_count();
+
+  /**
+   * @brief Checks whether this is the only pointer to the managed array.
+   *
+   * @return bool True if an array is managed and no other pointer shares it.
+   */
+  bool is_unique();
+
+  /**
+   * @brief Assignment operator for sharing ownership of the array.
+   *
+   * @param other The RefCountedPtr to assign from.
+   * @return RefCountedPtr<T[], Counter>& Reference to this RefCountedPtr.
+   */
+  RefCountedPtr<T[], Counter> &operator=(RefCountedPtr<T[], Counter> &);
+
+  /**
+   * @brief Move assignment operator transferring ownership of the array.
+   *
+   * @param other The RefCountedPtr to take ownership from; left empty.
+   * @return RefCountedPtr<T[], Counter>& Reference to this RefCountedPtr.
+   */
+  RefCountedPtr<T[], Counter> &
+  operator=(RefCountedPtr<T[], Counter> &&) noexcept;
+};
+
+/**
+ * @brief Creates a shared array of the given length in a single allocation.
+ *
+ * Elements are value-initialized, or copy-initialized from value when one is
+ * given, and the first element is aligned to at least Alignment bytes (for
+ * example 64 for AVX-512 loads).
+ *
+ * @tparam T The element type.
+ * @tparam Alignment Minimum alignment of the first element, a power of two.
+ * @tparam Counter The reference count policy.
+ * @tparam Args Either empty or a single value to copy into every element.
+ * @param length Number of elements.
+ * @param args Optional value to initialize the elements with.
+ * @return RefCountedPtr<T[], Counter> Pointer owning the new array.
+ */
+template <typename T, std::size_t Alignment = alignof(T),
+          typename Counter = RefCountedDefaultCounter, typename... Args>
+RefCountedPtr<T[], Counter> make_ref_counted_array(std::size_t,
+                                                   const Args &...);
+
+/**
+ * @brief Number of bytes make_ref_counted_in needs for a T.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Release Type of the release callback.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Release = void (*)(void *),
+          typename Counter = RefCountedDefaultCounter>
+inline constexpr std::size_t ref_counted_placement_size =
+    sizeof(RefCountedPlacementBlock<T, Release, Counter>);
+
+/**
+ * @brief Alignment make_ref_counted_in needs for a T.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Release Type of the release callback.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Release = void (*)(void *),
+          typename Counter = RefCountedDefaultCounter>
+inline constexpr std::size_t ref_counted_placement_alignment =
+    alignof(RefCountedPlacementBlock<T, Release, Counter>);
+
+/**
+ * @brief Creates a shared object inside caller-provided storage, without
+ * calling the heap allocator.
+ *
+ * The object and its control block are constructed at the start of storage.
+ * When the last reference is released both are destroyed and release is
+ * invoked with storage, so the caller can recycle it.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Release Callable invoked with the storage address.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param storage Start of the storage, aligned to at least
+ * ref_counted_placement_alignment.
+ * @param size Size of the storage in bytes, at least
+ * ref_counted_placement_size.
+ * @param release Callable invoked with storage once the object is released.
+ * @param args Arguments to pass to the T constructor.
+ * @return RefCountedPtr<T, Counter> Pointer owning the new object.
+ */
+template <typename T, typename Counter = RefCountedDefaultCounter,
+          typename Release, typename... Args>
+RefCountedPtr<T, Counter> make_ref_counted_in(void *, std::size_t, Release,
+                                              Args &&...);
+
+/**
+ * @brief Casts a RefCountedPtr with static_cast, sharing its control block.
+ *
+ * @tparam T The target type.
+ * @tparam U The source type.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to share ownership with.
+ * @return RefCountedPtr<T, Counter> Pointer to the same object as T.
+ */
+template <typename T, typename U, typename Counter>
+RefCountedPtr<T, Counter> static_pointer_cast(RefCountedPtr<U, Counter> &);
+
+/**
+ * @brief Casts a RefCountedPtr with static_cast, taking over its reference.
+ *
+ * @tparam T The target type.
+ * @tparam U The source type.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to take ownership from; left empty.
+ * @return RefCountedPtr<T, Counter> Pointer to the same object as T.
+ */
+template <typename T, typename U, typename Counter>
+RefCountedPtr<T, Counter> static_pointer_cast(RefCountedPtr<U, Counter> &&);
+
+/**
+ * @brief Casts a RefCountedPtr with dynamic_cast, sharing its control block.
+ *
+ * @tparam T The target type.
+ * @tparam U The source type.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to share ownership with.
+ * @return RefCountedPtr<T, Counter> Pointer to the same object as T, or an
+ * empty pointer if the object is not a T.
+ */
+template <typename T, typename U, typename Counter>
+RefCountedPtr<T, Counter> dynamic_pointer_cast(RefCountedPtr<U, Counter> &);
+
+/**
+ * @brief Casts a RefCountedPtr with dynamic_cast, taking over its reference
+ * if the cast succeeds.
+ *
+ * @tparam T The target type.
+ * @tparam U The source type.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to take ownership from; left untouched if the
+ * cast fails.
+ * @return RefCountedPtr<T, Counter> Pointer to the same object as T, or an
+ * empty pointer if the object is not a T.
+ */
+template <typename T, typename U, typename Counter>
+RefCountedPtr<T, Counter> dynamic_pointer_cast(RefCountedPtr<U, Counter> &&);
+
+/**
+ * @brief Casts a RefCountedPtr with const_cast, sharing its control block.
+ *
+ * @tparam T The target type.
+ * @tparam U The source type.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to share ownership with.
+ * @return RefCountedPtr<T, Counter> Pointer to the same object as T.
+ */
+template <typename T, typename U, typename Counter>
+RefCountedPtr<T, Counter> const_pointer_cast(RefCountedPtr<U, Counter> &);
+
+/**
+ * @brief Casts a RefCountedPtr with const_cast, taking over its reference.
+ *
+ * @tparam T The target type.
+ * @tparam U The source type.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to take ownership from; left empty.
+ * @return RefCountedPtr<T, Counter> Pointer to the same object as T.
+ */
+template <typename T, typename U, typename Counter>
+RefCountedPtr<T, Counter> const_pointer_cast(RefCountedPtr<U, Counter> &&);
+
+/**
+ * @brief Compact shared handle the size of a single pointer.
+ *
+ * Stores only a pointer to a fused control block; the object lives at a fixed
+ * offset inside that block, so sizeof(RefCountedHandle<T>) == sizeof(void *).
+ * Meant for large containers of handles, where it packs twice as many handles
+ * per cache line as RefCountedPtr, which stores an object pointer next to the
+ * control block pointer. A handle can be turned into a RefCountedPtr that
+ * shares the same control block.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter = RefCountedDefaultCounter>
+class REFCOUNTEDPTR_TRIVIALLY_RELOCATABLE REFCOUNTEDPTR_TRIVIAL_ABI
+    RefCountedHandle {
+private:
+  RefCountedInplaceBlock<T, RefCountedLayout::Packed, Counter>
+      *control_block; ///< Pointer to the fused control block.
+
+  /**
+   * @brief Initializes the handle with the given control block.
+   *
+   * @param control_block Pointer to the fused control block.
+   */
+  void init_data(
+      RefCountedInplaceBlock<T, RefCountedLayout::Packed, Counter> *);
+
+  /**
+   * @brief Drops this handle's reference, releasing the block if it was the
+   * last one.
+   */
+  void release_reference();
+
+public:
+  /**
+   * @brief Default constructor creating an empty handle.
+   */
+  constexpr RefCountedHandle() : control_block(nullptr) {}
+
+  /**
+   * @brief Constructs a handle with variadic arguments.
+   *
+   * Allocates a fused control block holding a new T built from the given
+   * arguments and sets the reference count to 1.
    *
    * @tparam Args Variadic template for constructor arguments.
    * @param args Arguments to pass to the T constructor.
    */
-  template <typename... Args> RefCountedPtr(Args &&...args);
+  template <typename... Args>
+    requires(!ref_counted_is_self<RefCountedHandle<T, Counter>, Args...>)
+  RefCountedHandle(Args &&...args);
 
   /**
    * @brief Copy constructor for sharing ownership.
    *
-   * Shares the managed object and reference count with another RefCountedPtr,
-   * incrementing the count.
-   *
-   * @param other The RefCountedPtr to share ownership with.
+   * @param other The handle to share ownership with.
    */
-  RefCountedPtr(RefCountedPtr<T> &);
+  RefCountedHandle(RefCountedHandle<T, Counter> &);
 
   /**
-   * @brief Destructor that cleans up resources.
+   * @brief Move constructor transferring ownership without touching the count.
    *
-   * Decrements the reference count and releases resources if it reaches zero.
+   * @param other The handle to take ownership from; left empty.
+   */
+  RefCountedHandle(RefCountedHandle<T, Counter> &&) noexcept;
+
+  /**
+   * @brief Destructor that releases the object when no references remain.
    */
-  virtual ~RefCountedPtr();
+  ~RefCountedHandle();
 
   /**
    * @brief Retrieves the raw pointer to the managed object.
    *
-   * Returns the underlying pointer, or nullptr if no object is managed.
+   * @return T* The managed object, or nullptr if the handle is empty.
+   */
+  T *get_data();
+
+  /**
+   * @brief Creates a RefCountedPtr sharing this handle's control block.
    *
-   * @return T* The raw pointer to the managed object.
+   * @return RefCountedPtr<T, Counter> Pointer sharing ownership with this
+   * handle.
    */
-  virtual T *get_data();
+  RefCountedPtr<T, Counter> get_ptr();
 
   /**
    * @brief Assignment operator for sharing ownership.
    *
-   * Releases current resources (if any) and shares ownership with another
-   * RefCountedPtr, adjusting reference counts accordingly.
+   * @param other The handle to assign from.
+   * @return RefCountedHandle<T, Counter>& Reference to this handle.
+   */
+  RefCountedHandle<T, Counter> &operator=(RefCountedHandle<T, Counter> &);
+
+  /**
+   * @brief Move assignment operator transferring ownership.
    *
-   * @param other The RefCountedPtr to assign from.
-   * @return RefCountedPtr<T>& Reference to this RefCountedPtr.
+   * @param other The handle to take ownership from; left empty.
+   * @return RefCountedHandle<T, Counter>& Reference to this handle.
+   */
+  RefCountedHandle<T, Counter> &
+  operator=(RefCountedHandle<T, Counter> &&) noexcept;
+};
+
+/**
+ * @brief Move-only owner of an object whose control block is already
+ * allocated.
+ *
+ * The object is built in a fused control block exactly like the variadic
+ * RefCountedPtr constructor does, but while ownership is unique the
+ * reference count is never touched. promote() turns the pointer into a
+ * RefCountedPtr with a plain store of the initial count, so publishing an
+ * object costs no allocation and no atomic read-modify-write.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter = RefCountedDefaultCounter>
+class REFCOUNTEDPTR_TRIVIALLY_RELOCATABLE REFCOUNTEDPTR_TRIVIAL_ABI
+    RefCountedUniquePtr {
+private:
+  T *data; ///< Pointer to the managed object.
+  RefCountedControlBlock<Counter>
+      *control_block; ///< Reserved control block, or nullptr if the object
+                      ///< is disposed of with delete.
+
+  /**
+   * @brief Disposes of the managed object, if any.
+   */
+  void release_data();
+
+  template <typename, typename> friend class RefCountedPtr;
+
+  /**
+   * @brief Takes over an object and its control block.
+   *
+   * @param data Pointer to the managed object.
+   * @param control_block Reserved control block, or nullptr.
+   */
+  RefCountedUniquePtr(T *, RefCountedControlBlock<Counter> *);
+
+public:
+  /**
+   * @brief Default constructor creating an empty pointer.
+   */
+  constexpr RefCountedUniquePtr() : data(nullptr), control_block(nullptr) {}
+
+  /**
+   * @brief Constructs the object and its control block in one allocation.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param args Arguments to pass to the T constructor.
+   */
+  template <typename... Args>
+    requires(!ref_counted_is_self<RefCountedUniquePtr<T, Counter>, Args...>)
+  RefCountedUniquePtr(Args &&...args);
+
+  RefCountedUniquePtr(const RefCountedUniquePtr<T, Counter> &) = delete;
+  RefCountedUniquePtr<T, Counter> &
+  operator=(const RefCountedUniquePtr<T, Counter> &) = delete;
+
+  /**
+   * @brief Move constructor transferring ownership.
+   *
+   * @param other The pointer to take ownership from; left empty.
+   */
+  RefCountedUniquePtr(RefCountedUniquePtr<T, Counter> &&) noexcept;
+
+  /**
+   * @brief Destructor that destroys the object.
+   */
+  ~RefCountedUniquePtr();
+
+  /**
+   * @brief Retrieves the raw pointer to the managed object.
+   *
+   * @return T* The managed object, or nullptr if the pointer is empty.
+   */
+  T *get_data();
+
+  /**
+   * @brief Converts unique ownership into shared ownership.
+   *
+   * This pointer is left empty.
+   *
+   * @return RefCountedPtr<T, Counter> The only reference to the object.
    */
-  virtual RefCountedPtr<T> &operator=(RefCountedPtr<T> &);
+  RefCountedPtr<T, Counter> promote();
+
+  /**
+   * @brief Move assignment operator transferring ownership.
+   *
+   * @param other The pointer to take ownership from; left empty.
+   * @return RefCountedUniquePtr<T, Counter>& Reference to this pointer.
+   */
+  RefCountedUniquePtr<T, Counter> &
+  operator=(RefCountedUniquePtr<T, Counter> &&) noexcept;
+};
+
+/**
+ * @brief Non-owning borrow of an object managed by a RefCountedPtr.
+ *
+ * Meant for parameters that only use the object during a call: binding a
+ * RefCountedRef to a RefCountedPtr copies two pointers and leaves the shared
+ * count alone, and get_ptr() upgrades to an owning pointer when the callee
+ * needs to keep the object. The borrowed pointer must outlive the borrow.
+ * A tracking borrow is counted in the control block, and releasing the last
+ * owner while one exists aborts the program.
+ *
+ * @tparam T The type of the borrowed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Track Whether the borrow is counted; defaults to
+ * REFCOUNTEDPTR_TRACK_BORROWS.
+ */
+template <typename T, typename Counter = RefCountedDefaultCounter,
+          bool Track = REFCOUNTEDPTR_TRACK_BORROWS>
+class REFCOUNTEDPTR_TRIVIALLY_RELOCATABLE RefCountedRef {
+private:
+  T *data; ///< Pointer to the borrowed object.
+  RefCountedControlBlock<Counter>
+      *control_block; ///< Control block of the owning pointer.
+
+  /**
+   * @brief Registers this borrow with the control block, if tracking.
+   */
+  void add_borrow();
+
+  /**
+   * @brief Unregisters this borrow from the control block, if tracking.
+   */
+  void release_borrow();
+
+public:
+  /**
+   * @brief Default constructor creating an empty borrow.
+   */
+  constexpr RefCountedRef() : data(nullptr), control_block(nullptr) {}
+
+  /**
+   * @brief Borrows the object of a RefCountedPtr.
+   *
+   * A lazily owned object gets its control block first, so the borrow can
+   * be upgraded later.
+   *
+   * @param owner The pointer to borrow from.
+   */
+  RefCountedRef(RefCountedPtr<T, Counter> &);
+
+  /**
+   * @brief Borrowing a temporary would dangle immediately.
+   */
+  RefCountedRef(RefCountedPtr<T, Counter> &&) = delete;
+
+  /**
+   * @brief Copy constructor creating another borrow of the same object.
+   *
+   * @param other The borrow to copy.
+   */
+  RefCountedRef(const RefCountedRef<T, Counter, Track> &);
+
+  /**
+   * @brief Destructor that ends the borrow.
+   */
+  ~RefCountedRef();
+
+  /**
+   * @brief Retrieves the raw pointer to the borrowed object.
+   *
+   * @return T* The borrowed object, or nullptr if the borrow is empty.
+   */
+  T *get_data();
+
+  /**
+   * @brief Upgrades the borrow to an owning pointer.
+   *
+   * @return RefCountedPtr<T, Counter> Pointer sharing ownership of the
+   * object.
+   */
+  RefCountedPtr<T, Counter> get_ptr();
+
+  /**
+   * @brief Assignment operator borrowing the object of another borrow.
+   *
+   * @param other The borrow to copy.
+   * @return RefCountedRef<T, Counter, Track>& Reference to this borrow.
+   */
+  RefCountedRef<T, Counter, Track> &
+  operator=(const RefCountedRef<T, Counter, Track> &);
 };
 
+/**
+ * @brief RefCountedPtr only holds pointers, so it can be relocated with a
+ * memory copy.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+struct ref_counted_is_trivially_relocatable<RefCountedPtr<T, Counter>>
+    : std::true_type {};
+
+/**
+ * @brief RefCountedHandle only holds a pointer, so it can be relocated with a
+ * memory copy.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+struct ref_counted_is_trivially_relocatable<RefCountedHandle<T, Counter>>
+    : std::true_type {};
+
+/**
+ * @brief RefCountedUniquePtr only holds pointers, so it can be relocated with
+ * a memory copy.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+struct ref_counted_is_trivially_relocatable<RefCountedUniquePtr<T, Counter>>
+    : std::true_type {};
+
+/**
+ * @brief RefCountedRef only holds pointers, so it can be relocated with a
+ * memory copy.
+ *
+ * @tparam T The type of the borrowed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Track Whether the borrow is counted.
+ */
+template <typename T, typename Counter, bool Track>
+struct ref_counted_is_trivially_relocatable<RefCountedRef<T, Counter, Track>>
+    : std::true_type {};
+
 #include "RefCountedPtr.tpp"
 
 #endif
\ No newline at end of file
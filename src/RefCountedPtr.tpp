@@ -1,133 +1,2343 @@
 #include "RefCountedPtr.h"
+#include <algorithm>
 #include <atomic>
+#include <concepts>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <typeinfo>
 #include <utility>
 
 /**
- * @brief Initializes the RefCountedPtr with a managed object and reference
- * count.
+ * @brief Adds a reference to the count.
  *
- * Sets the data pointer and associates it with a shared reference count,
- * incrementing the count atomically to reflect the new ownership.
+ * Wide counters use a single relaxed increment. Saturating counters stop at
+ * their maximum, and narrow counters move every reference beyond their
+ * maximum into the overflow table.
+ *
+ * @tparam Count Integer type stored in the control block.
+ * @tparam Saturating Whether the count saturates instead of overflowing.
+ * @param count The shared reference count.
+ */
+template <typename Count, bool Saturating>
+void RefCountedCounter<Count, Saturating>::increment(
+    std::atomic<Count> &count) {
+  if constexpr (!Saturating && !spills) {
+    count.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    Count current = count.load(std::memory_order_relaxed);
+    while (true) {
+      if (current == maximum) {
+        if constexpr (Saturating) {
+          return;
+        } else {
+          // A counter at its maximum only changes while the table is locked.
+          OverflowTable &table = overflow_table();
+          std::lock_guard<std::mutex> lock(table.mutex);
+          if (count.load(std::memory_order_relaxed) == maximum) {
+            ++table.counts[&count];
+            return;
+          }
+          current = count.load(std::memory_order_relaxed);
+          continue;
+        }
+      }
+      if (count.compare_exchange_weak(current, current + 1,
+                                      std::memory_order_relaxed)) {
+        return;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Removes a reference from the count.
+ *
+ * A saturated counter is never decremented. A narrow counter at its maximum
+ * first drains its entry in the overflow table before counting down again.
+ *
+ * @tparam Count Integer type stored in the control block.
+ * @tparam Saturating Whether the count saturates instead of overflowing.
+ * @param count The shared reference count.
+ * @return bool True if the last reference was removed.
+ */
+template <typename Count, bool Saturating>
+bool RefCountedCounter<Count, Saturating>::decrement(
+    std::atomic<Count> &count) {
+  if constexpr (!Saturating && !spills) {
+    return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  } else {
+    Count current = count.load(std::memory_order_relaxed);
+    while (true) {
+      if (current == maximum) {
+        if constexpr (Saturating) {
+          return false;
+        } else {
+          OverflowTable &table = overflow_table();
+          std::lock_guard<std::mutex> lock(table.mutex);
+          if (count.load(std::memory_order_relaxed) == maximum) {
+            auto spilled = table.counts.find(&count);
+            if (spilled != table.counts.end()) {
+              if (--spilled->second == 0) {
+                table.counts.erase(spilled);
+              }
+            } else {
+              count.store(maximum - 1, std::memory_order_release);
+            }
+            return false;
+          }
+          current = count.load(std::memory_order_relaxed);
+          continue;
+        }
+      }
+      if (count.compare_exchange_weak(current, current - 1,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_relaxed)) {
+        return current == 1;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Reads the number of references, including spilled ones.
+ *
+ * The count is loaded with acquire ordering. Only a narrow counter sitting
+ * at its maximum takes the overflow table lock to add its spilled entry.
+ *
+ * @tparam Count Integer type stored in the control block.
+ * @tparam Saturating Whether the count saturates instead of overflowing.
+ * @param count The shared reference count.
+ * @return std::uint64_t The number of references.
+ */
+template <typename Count, bool Saturating>
+std::uint64_t
+RefCountedCounter<Count, Saturating>::load(std::atomic<Count> &count) {
+  Count current = count.load(std::memory_order_acquire);
+  if constexpr (spills) {
+    if (current == maximum) {
+      OverflowTable &table = overflow_table();
+      std::lock_guard<std::mutex> lock(table.mutex);
+      current = count.load(std::memory_order_acquire);
+      if (current == maximum) {
+        auto spilled = table.counts.find(&count);
+        if (spilled != table.counts.end()) {
+          return static_cast<std::uint64_t>(maximum) + spilled->second;
+        }
+      }
+    }
+  }
+  return static_cast<std::uint64_t>(current);
+}
+
+/**
+ * @brief Retrieves the process-wide overflow table of this counter type.
+ *
+ * @tparam Count Integer type stored in the control block.
+ * @tparam Saturating Whether the count saturates instead of overflowing.
+ * @return OverflowTable& The overflow table.
+ */
+template <typename Count, bool Saturating>
+typename RefCountedCounter<Count, Saturating>::OverflowTable &
+RefCountedCounter<Count, Saturating>::overflow_table() {
+  static OverflowTable table;
+  return table;
+}
+
+/**
+ * @brief Relocates objects to a new address, ending their lifetime at the
+ * old one.
+ *
+ * Overlapping ranges are walked front to back when moving towards lower
+ * addresses and back to front otherwise, so no object is overwritten before
+ * it has been moved.
+ *
+ * @tparam T The type of the objects.
+ * @param source First object to relocate.
+ * @param count Number of objects to relocate.
+ * @param destination Uninitialized storage for count objects.
+ */
+template <typename T>
+void ref_counted_relocate(T *source, std::size_t count, T *destination) {
+  if (count == 0 || source == destination) {
+    return;
+  }
+  if constexpr (ref_counted_is_trivially_relocatable_v<T>) {
+    std::memmove(static_cast<void *>(destination),
+                 static_cast<const void *>(source), count * sizeof(T));
+  } else if (destination < source) {
+    for (std::size_t index = 0; index < count; ++index) {
+      ::new (static_cast<void *>(destination + index))
+          T(std::move(source[index]));
+      std::destroy_at(source + index);
+    }
+  } else {
+    for (std::size_t index = count; index > 0; --index) {
+      ::new (static_cast<void *>(destination + index - 1))
+          T(std::move(source[index - 1]));
+      std::destroy_at(source + index - 1);
+    }
+  }
+}
+
+/**
+ * @brief Copy-constructs an object from a non-const lvalue.
+ *
+ * @tparam T The type of the object.
+ * @param destination Uninitialized storage for the copy.
+ * @param source The object to copy.
+ */
+template <typename T>
+void ref_counted_copy_construct(T *destination, T &source) {
+  ::new (static_cast<void *>(destination)) T(source);
+}
+
+/**
+ * @brief Copy-constructs a pair from a non-const lvalue, member by member.
+ *
+ * @tparam First The type of the first member.
+ * @tparam Second The type of the second member.
+ * @param destination Uninitialized storage for the copy.
+ * @param source The pair to copy.
+ */
+template <typename First, typename Second>
+void ref_counted_copy_construct(std::pair<First, Second> *destination,
+                                std::pair<First, Second> &source) {
+  ::new (static_cast<void *>(destination))
+      std::pair<First, Second>(std::piecewise_construct,
+                               std::forward_as_tuple(source.first),
+                               std::forward_as_tuple(source.second));
+}
+
+/**
+ * @brief Constructs a control block with a reference count of zero.
+ *
+ * Starts the lifetime of the integer count during constant evaluation and of
+ * the atomic one otherwise.
+ *
+ * @tparam Counter The reference count policy.
+ */
+template <typename Counter>
+constexpr RefCountedControlBlock<Counter>::RefCountedControlBlock() {
+  if (std::is_constant_evaluated()) {
+    std::construct_at(&constant_references, 0);
+  } else {
+    std::construct_at(&shared_references, 0);
+  }
+}
+
+/**
+ * @brief Adds a reference to the count.
+ *
+ * @tparam Counter The reference count policy.
+ */
+template <typename Counter>
+constexpr void RefCountedControlBlock<Counter>::add_reference() {
+  if (std::is_constant_evaluated()) {
+    ++constant_references;
+  } else {
+    Counter::increment(shared_references);
+  }
+}
+
+/**
+ * @brief Removes a reference from the count.
+ *
+ * @tparam Counter The reference count policy.
+ * @return bool True if the last reference was removed.
+ */
+template <typename Counter>
+constexpr bool RefCountedControlBlock<Counter>::remove_reference() {
+  if (std::is_constant_evaluated()) {
+    return --constant_references == 0;
+  }
+  return Counter::decrement(shared_references);
+}
+
+/**
+ * @brief Aborts if a tracked RefCountedRef still borrows the object.
+ *
+ * @tparam Counter The reference count policy.
+ */
+template <typename Counter>
+constexpr void RefCountedControlBlock<Counter>::check_borrows() {
+  if (!std::is_constant_evaluated() &&
+      borrows.load(std::memory_order_acquire) != 0) {
+    std::fputs("RefCountedPtr: last owner released while a RefCountedRef "
+               "still borrows the object\n",
+               stderr);
+    std::abort();
+  }
+}
+
+/**
+ * @brief Blocks until the reference count equals the given value.
+ *
+ * Threads sleep on a process-wide epoch rather than on the count itself, so
+ * a releasing thread never touches a control block that may already have
+ * been freed. The count is read with a read-modify-write: every decrement is
+ * then either seen here or ordered after this thread registered as a waiter,
+ * in which case the releasing thread sees the registration and notifies.
+ *
+ * @tparam Counter The reference count policy.
+ * @param target The count to wait for.
+ */
+template <typename Counter>
+void RefCountedControlBlock<Counter>::wait_for_count(
+    typename Counter::value_type target) {
+  Waiters &state = waiters();
+  state.count.fetch_add(1, std::memory_order_relaxed);
+  while (true) {
+    std::uint32_t epoch = state.epoch.load(std::memory_order_acquire);
+    if (shared_references.fetch_add(0, std::memory_order_acq_rel) ==
+        target) {
+      break;
+    }
+    state.epoch.wait(epoch, std::memory_order_acquire);
+  }
+  state.count.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Wakes threads blocked in wait_for_count after a reference has been
+ * dropped.
+ *
+ * @tparam Counter The reference count policy.
+ */
+template <typename Counter>
+void RefCountedControlBlock<Counter>::notify_release() {
+  Waiters &state = waiters();
+  if (state.count.load(std::memory_order_relaxed) != 0) {
+    state.epoch.fetch_add(1, std::memory_order_release);
+    state.epoch.notify_all();
+  }
+}
+
+/**
+ * @brief Retrieves the waiter state of this counter type.
+ *
+ * @tparam Counter The reference count policy.
+ * @return Waiters& The waiter state.
+ */
+template <typename Counter>
+typename RefCountedControlBlock<Counter>::Waiters &
+RefCountedControlBlock<Counter>::waiters() {
+  static Waiters state;
+  return state;
+}
+
+/**
+ * @brief Links an object derived from EnableRefCountedFromThis to the control
+ * block that owns it.
+ *
+ * @tparam U The type passed to the mixin.
+ * @tparam Counter The reference count policy.
+ * @param object The object, or nullptr.
+ * @param control_block The control block owning the object.
+ * @return std::true_type Marks types that need the link.
+ */
+template <typename U, typename Counter>
+constexpr std::true_type
+ref_counted_link_self(EnableRefCountedFromThis<U, Counter> *object,
+                      RefCountedControlBlock<Counter> *control_block) {
+  // Blocks that build their object in place link it while it is still under
+  // construction, which is also how they link at compile time, and GCC
+  // rejects the null check on such a base there. A null object in a constant
+  // expression fails to compile instead of crashing.
+  if (std::is_constant_evaluated() || object != nullptr) {
+    object->self_control_block = control_block;
+  }
+  return {};
+}
+
+/**
+ * @brief Fallback for objects that do not use EnableRefCountedFromThis.
+ *
+ * @tparam Counter The reference count policy.
+ * @param object The object.
+ * @param control_block The control block owning the object.
+ * @return std::false_type Marks types that need no link.
+ */
+template <typename Counter>
+constexpr std::false_type
+ref_counted_link_self(const volatile void *,
+                      RefCountedControlBlock<Counter> *) {
+  return {};
+}
+
+/**
+ * @brief Creates a RefCountedPtr sharing the control block that owns this
+ * object.
+ *
+ * @tparam T The derived type.
+ * @tparam Counter The reference count policy of the owning pointers.
+ * @return RefCountedPtr<T, Counter> Pointer sharing ownership of this object,
+ * or an empty pointer if it is not owned by a control block.
+ */
+template <typename T, typename Counter>
+RefCountedPtr<T, Counter>
+EnableRefCountedFromThis<T, Counter>::ref_from_this() {
+  RefCountedPtr<T, Counter> pointer;
+  if (self_control_block != nullptr) {
+    pointer.init_data(static_cast<T *>(this), self_control_block);
+  }
+  return pointer;
+}
+
+/**
+ * @brief Constructs a control block owning the given pointer.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Deleter Callable invoked with the raw pointer on release.
+ * @tparam Counter The reference count policy.
+ * @param data The raw pointer to manage.
+ * @param deleter The deleter used to dispose of data.
+ */
+template <typename T, typename Deleter, typename Counter>
+constexpr RefCountedPointerBlock<T, Deleter, Counter>::RefCountedPointerBlock(
+    T *data, Deleter deleter)
+    : data(data), deleter(std::move(deleter)) {}
+
+/**
+ * @brief Invokes the deleter on the managed object and frees the block.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Deleter Callable invoked with the raw pointer on release.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Deleter, typename Counter>
+constexpr void RefCountedPointerBlock<T, Deleter, Counter>::release_data() {
+  deleter(data);
+  delete this;
+}
+
+/**
+ * @brief Constructs the managed object in place.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Layout The memory layout of the block.
+ * @tparam Counter The reference count policy.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param args Arguments forwarded to the T constructor.
+ */
+template <typename T, RefCountedLayout Layout, typename Counter>
+template <typename... Args>
+RefCountedInplaceBlock<T, Layout, Counter>::RefCountedInplaceBlock(
+    Args &&...args)
+    : data(std::forward<Args>(args)...) {}
+
+/**
+ * @brief Retrieves a pointer to the inline object.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Layout The memory layout of the block.
+ * @tparam Counter The reference count policy.
+ * @return T* Pointer to the managed object.
+ */
+template <typename T, RefCountedLayout Layout, typename Counter>
+T *RefCountedInplaceBlock<T, Layout, Counter>::get_data() {
+  return &data;
+}
+
+/**
+ * @brief Destroys the inline object together with the block.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Layout The memory layout of the block.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, RefCountedLayout Layout, typename Counter>
+void RefCountedInplaceBlock<T, Layout, Counter>::release_data() {
+  delete this;
+}
+
+/**
+ * @brief Constructs the block header for an already constructed array.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @param length Number of elements following the block.
+ * @param alignment Alignment the allocation was made with.
+ */
+template <typename T, typename Counter>
+RefCountedArrayBlock<T, Counter>::RefCountedArrayBlock(std::size_t length,
+                                                       std::size_t alignment)
+    : length(length), alignment(alignment) {}
+
+/**
+ * @brief Computes the offset of the first element from the block start.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @param alignment Alignment of the allocation and its elements.
+ * @return std::size_t Offset rounded up to a multiple of alignment.
+ */
+template <typename T, typename Counter>
+std::size_t
+RefCountedArrayBlock<T, Counter>::elements_offset(std::size_t alignment) {
+  return (sizeof(RefCountedArrayBlock<T, Counter>) + alignment - 1) &
+         ~(alignment - 1);
+}
+
+/**
+ * @brief Allocates a block and its elements in a single allocation.
+ *
+ * The allocation is aligned to the larger of the requested alignment and the
+ * natural alignment of the block and of T. Elements are constructed first so a
+ * throwing constructor never leaves a half-built block behind. Throws
+ * std::bad_array_new_length if the allocation size would overflow.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @tparam Args Either empty or a single value to copy into every element.
+ * @param length Number of elements to allocate.
+ * @param alignment Minimum alignment of the first element.
+ * @param args Optional value to initialize the elements with.
+ * @return RefCountedArrayBlock<T, Counter>* The new block, with a reference
+ * count of zero.
+ */
+template <typename T, typename Counter>
+template <typename... Args>
+RefCountedArrayBlock<T, Counter> *
+RefCountedArrayBlock<T, Counter>::create(std::size_t length,
+                                         std::size_t alignment,
+                                         const Args &...args) {
+  static_assert(sizeof...(Args) <= 1,
+                "array elements take at most one initial value");
+  alignment = std::max(
+      {alignment, alignof(T), alignof(RefCountedArrayBlock<T, Counter>)});
+  std::size_t offset = elements_offset(alignment);
+  if (length >
+      (std::numeric_limits<std::size_t>::max() - offset) / sizeof(T)) {
+    throw std::bad_array_new_length();
+  }
+  void *memory = ::operator new(offset + length * sizeof(T),
+                                std::align_val_t(alignment));
+  T *elements = reinterpret_cast<T *>(static_cast<char *>(memory) + offset);
+  try {
+    if constexpr (sizeof...(Args) == 0) {
+      std::uninitialized_value_construct_n(elements, length);
+    } else {
+      std::uninitialized_fill_n(elements, length, args...);
+    }
+  } catch (...) {
+    ::operator delete(memory, std::align_val_t(alignment));
+    throw;
+  }
+  return new (memory) RefCountedArrayBlock<T, Counter>(length, alignment);
+}
+
+/**
+ * @brief Retrieves a pointer to the first element.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @return T* Pointer to the first element.
+ */
+template <typename T, typename Counter>
+T *RefCountedArrayBlock<T, Counter>::get_data() {
+  return reinterpret_cast<T *>(reinterpret_cast<char *>(this) +
+                               elements_offset(alignment));
+}
+
+/**
+ * @brief Retrieves the number of elements in the array.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @return std::size_t The number of elements.
+ */
+template <typename T, typename Counter>
+std::size_t RefCountedArrayBlock<T, Counter>::get_length() {
+  return length;
+}
+
+/**
+ * @brief Destroys the elements and frees the whole allocation.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+void RefCountedArrayBlock<T, Counter>::release_data() {
+  std::align_val_t allocation_alignment = std::align_val_t(alignment);
+  std::destroy_n(get_data(), length);
+  this->~RefCountedArrayBlock<T, Counter>();
+  ::operator delete(static_cast<void *>(this), allocation_alignment);
+}
+
+/**
+ * @brief Constructs the object in place.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Release Callable returning the storage.
+ * @tparam Counter The reference count policy.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param release Callable returning the storage.
+ * @param args Arguments forwarded to the T constructor.
+ */
+template <typename T, typename Release, typename Counter>
+template <typename... Args>
+RefCountedPlacementBlock<T, Release, Counter>::RefCountedPlacementBlock(
+    Release release, Args &&...args)
+    : release(std::move(release)), data(std::forward<Args>(args)...) {}
+
+/**
+ * @brief Constructs a block and its object at the start of the given storage.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Release Callable returning the storage.
+ * @tparam Counter The reference count policy.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param storage Start of the storage.
+ * @param size Size of the storage in bytes.
+ * @param release Callable invoked with storage once the object is released.
+ * @param args Arguments forwarded to the T constructor.
+ * @return RefCountedPlacementBlock<T, Release, Counter>* The new block, with
+ * a reference count of zero.
+ */
+template <typename T, typename Release, typename Counter>
+template <typename... Args>
+RefCountedPlacementBlock<T, Release, Counter> *
+RefCountedPlacementBlock<T, Release, Counter>::create(void *storage,
+                                                      std::size_t size,
+                                                      Release release,
+                                                      Args &&...args) {
+  if (storage == nullptr ||
+      size < sizeof(RefCountedPlacementBlock<T, Release, Counter>) ||
+      reinterpret_cast<std::uintptr_t>(storage) %
+              alignof(RefCountedPlacementBlock<T, Release, Counter>) !=
+          0) {
+    throw std::bad_alloc();
+  }
+  return ::new (storage) RefCountedPlacementBlock<T, Release, Counter>(
+      std::move(release), std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Retrieves a pointer to the inline object.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Release Callable returning the storage.
+ * @tparam Counter The reference count policy.
+ * @return T* Pointer to the managed object.
+ */
+template <typename T, typename Release, typename Counter>
+T *RefCountedPlacementBlock<T, Release, Counter>::get_data() {
+  return &data;
+}
+
+/**
+ * @brief Destroys the object and the block, then hands the storage back.
+ *
+ * The callback is moved out first, since it lives in the block being
+ * destroyed. The block was constructed at the start of the storage, so its
+ * own address is the one to return.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Release Callable returning the storage.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Release, typename Counter>
+void RefCountedPlacementBlock<T, Release, Counter>::release_data() {
+  Release owner = std::move(release);
+  void *storage = static_cast<void *>(this);
+  this->~RefCountedPlacementBlock<T, Release, Counter>();
+  owner(storage);
+}
+
+/**
+ * @brief Retrieves the std::shared_ptr keeping the object alive, for blocks
+ * created from one.
+ *
+ * @tparam Counter The reference count policy.
+ * @return std::shared_ptr<const void> Always empty for this block type.
+ */
+template <typename Counter>
+std::shared_ptr<const void>
+RefCountedControlBlock<Counter>::get_shared_owner() {
+  return nullptr;
+}
+
+/**
+ * @brief Checks whether owners outside the reference count, such as
+ * std::shared_ptr instances, still share the object.
+ *
+ * @tparam Counter The reference count policy.
+ * @return bool Always false for this block type.
+ */
+template <typename Counter>
+bool RefCountedControlBlock<Counter>::has_external_owners() {
+  return false;
+}
+
+/**
+ * @brief Checks whether the object is never released, whatever happens to
+ * the reference count.
+ *
+ * @tparam Counter The reference count policy.
+ * @return bool Always false for this block type.
+ */
+template <typename Counter>
+bool RefCountedControlBlock<Counter>::is_immortal() {
+  return false;
+}
+
+/**
+ * @brief Constructs a block keeping the given owner alive.
+ *
+ * @tparam Counter The reference count policy.
+ * @param owner The std::shared_ptr owning the object.
+ */
+template <typename Counter>
+RefCountedSharedBlock<Counter>::RefCountedSharedBlock(
+    std::shared_ptr<const void> owner)
+    : owner(std::move(owner)) {}
+
+/**
+ * @brief Retrieves the std::shared_ptr keeping the object alive.
+ *
+ * @tparam Counter The reference count policy.
+ * @return std::shared_ptr<const void> The owning std::shared_ptr.
+ */
+template <typename Counter>
+std::shared_ptr<const void> RefCountedSharedBlock<Counter>::get_shared_owner() {
+  return owner;
+}
+
+/**
+ * @brief Checks whether other std::shared_ptr instances share the object.
+ *
+ * std::shared_ptr reads its count relaxed; the fence orders the caller's
+ * accesses to the object after the releases it observed.
+ *
+ * @tparam Counter The reference count policy.
+ * @return bool True if the held std::shared_ptr is not the only one.
+ */
+template <typename Counter>
+bool RefCountedSharedBlock<Counter>::has_external_owners() {
+  bool shared = owner.use_count() > 1;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return shared;
+}
+
+/**
+ * @brief Drops the std::shared_ptr and frees the block.
+ *
+ * @tparam Counter The reference count policy.
+ */
+template <typename Counter>
+void RefCountedSharedBlock<Counter>::release_data() {
+  delete this;
+}
+
+/**
+ * @brief Drops the reference held by the deleter.
+ *
+ * @tparam Counter The reference count policy.
+ * @param data The pointer the std::shared_ptr was created with.
+ */
+template <typename Counter>
+void RefCountedSharedDeleter<Counter>::operator()(const volatile void *) {
+  owner = RefCountedPtr<const void, Counter>();
+}
+
+/**
+ * @brief Constructs a block that owns nothing yet.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+RefCountedBridgeBlock<T, Counter>::RefCountedBridgeBlock() : data(nullptr) {}
+
+/**
+ * @brief Move constructor used while the std::shared_ptr stores the block.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param other The block to move from; it owns nothing yet.
+ */
+template <typename T, typename Counter>
+RefCountedBridgeBlock<T, Counter>::RefCountedBridgeBlock(
+    RefCountedBridgeBlock<T, Counter> &&)
+    : data(nullptr) {}
+
+/**
+ * @brief Takes over a lazily owned object and the std::shared_ptr storing
+ * this block, and adds the reference of the converting RefCountedPtr.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param shared The std::shared_ptr whose deleter is this block.
+ */
+template <typename T, typename Counter>
+void RefCountedBridgeBlock<T, Counter>::adopt(std::shared_ptr<T> &shared) {
+  data = shared.get();
+  owner = shared;
+  this->add_reference();
+}
+
+/**
+ * @brief Adds a reference unless the count has already dropped to zero.
+ *
+ * A count of zero means the block is dropping its std::shared_ptr, so it
+ * must not be revived.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @return bool True if a reference was added.
+ */
+template <typename T, typename Counter>
+bool RefCountedBridgeBlock<T, Counter>::try_add_reference() {
+  typename Counter::value_type current =
+      this->shared_references.load(std::memory_order_relaxed);
+  while (current != 0) {
+    if (current == std::numeric_limits<typename Counter::value_type>::max()) {
+      // Saturated or spilled counts are only changed by the policy
+      Counter::increment(this->shared_references);
+      return true;
+    }
+    if (this->shared_references.compare_exchange_weak(
+            current, current + 1, std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Retrieves the std::shared_ptr keeping the object alive.
+ *
+ * Only called through a RefCountedPtr holding a reference, so the owner is
+ * set and not changing.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @return std::shared_ptr<const void> The owner shared by every to_shared.
+ */
+template <typename T, typename Counter>
+std::shared_ptr<const void>
+RefCountedBridgeBlock<T, Counter>::get_shared_owner() {
+  return owner;
+}
+
+/**
+ * @brief Checks whether std::shared_ptr instances from to_shared are still
+ * alive.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @return bool True if the held std::shared_ptr is not the only one.
+ */
+template <typename T, typename Counter>
+bool RefCountedBridgeBlock<T, Counter>::has_external_owners() {
+  bool shared = owner.use_count() > 1;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return shared;
+}
+
+/**
+ * @brief Drops the std::shared_ptr held for the RefCountedPtr instances.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+void RefCountedBridgeBlock<T, Counter>::release_data() {
+  // The last std::shared_ptr frees this block, so leave the member first
+  std::shared_ptr<const void> last = std::move(owner);
+}
+
+/**
+ * @brief Deletes the object once the last std::shared_ptr is gone.
+ *
+ * Deletes the adopted object rather than the argument, so a std::shared_ptr
+ * that fails to allocate leaves the lazily owned object alone.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param data The pointer the std::shared_ptr was created with.
+ */
+template <typename T, typename Counter>
+void RefCountedBridgeBlock<T, Counter>::operator()(T *) {
+  delete data;
+}
+
+/**
+ * @brief Initializes the RefCountedPtr with a managed object and control
+ * block.
+ *
+ * Sets the data pointer and associates it with a shared control block,
+ * incrementing its reference count atomically to reflect the new ownership.
+ * An empty control block leaves the pointer empty.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param data Pointer to the object to manage.
+ * @param control_block Pointer to the shared control block.
+ */
+template <typename T, typename Counter>
+constexpr void RefCountedPtr<T, Counter>::init_data(
+    T *data, RefCountedControlBlock<Counter> *control_block) {
+  this->data = data;
+  this->control_block = control_block;
+  if (control_block != nullptr) {
+    control_block->add_reference();
+  }
+}
+
+/**
+ * @brief Releases the managed object and its control block.
+ *
+ * Delegates to the control block, which disposes of the object with the
+ * deleter chosen at construction and then frees itself.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+constexpr void RefCountedPtr<T, Counter>::release_data() {
+  control_block->check_borrows();
+  control_block->release_data();
+}
+
+/**
+ * @brief Drops this pointer's reference, releasing the object if it was the
+ * last one.
+ *
+ * A pointer without a control block either is empty or holds a lazily owned
+ * object with an implicit count of one, which is deleted directly. A
+ * RefCountedPtr<void> is only ever converted from a typed pointer, which
+ * gives it a control block, so it is never lazily owned.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+constexpr void RefCountedPtr<T, Counter>::release_reference() {
+  if (control_block != nullptr) {
+    if (control_block->remove_reference()) {
+      release_data();
+    } else if (!std::is_constant_evaluated()) {
+      RefCountedControlBlock<Counter>::notify_release();
+    }
+  } else if constexpr (!std::is_void_v<T>) {
+    delete data;
+  }
+}
+
+/**
+ * @brief Allocates the control block of a lazily owned object.
+ *
+ * The new block starts with a count of one, standing for the implicit
+ * reference this pointer already held.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+constexpr void RefCountedPtr<T, Counter>::share() {
+  if constexpr (!std::is_void_v<T>) {
+    if (control_block == nullptr && data != nullptr) {
+      control_block =
+          new RefCountedPointerBlock<T, std::default_delete<T>, Counter>(data,
+                                                                         {});
+      control_block->add_reference();
+      ref_counted_link_self(data, control_block);
+    }
+  }
+}
+
+/**
+ * @brief Retrieves the raw pointer to the managed object.
+ *
+ * Provides direct access to the underlying object, returning nullptr if no
+ * object is managed.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @return T* The raw pointer to the managed object.
+ */
+template <typename T, typename Counter>
+constexpr T *RefCountedPtr<T, Counter>::get_data() {
+  return data;
+}
+
+/**
+ * @brief Wraps an immortal object in static storage.
+ *
+ * During constant evaluation the count is left alone, since atomics cannot
+ * be modified there; the block's immortal count absorbs the matching
+ * decrement when the pointer is destroyed.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param block The static block holding the object.
+ */
+template <typename T, typename Counter>
+constexpr RefCountedPtr<T, Counter>::RefCountedPtr(
+    RefCountedStaticBlock<T, Counter> &block)
+    : data(block.get_data()), control_block(&block) {
+  if (!std::is_constant_evaluated()) {
+    Counter::increment(control_block->shared_references);
+  }
+}
+
+/**
+ * @brief Constructs a RefCountedPtr from a block built in caller-provided
+ * storage.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Release Callable returning the storage.
+ * @param control_block The placement block to manage.
+ */
+template <typename T, typename Counter>
+template <typename Release>
+RefCountedPtr<T, Counter>::RefCountedPtr(
+    RefCountedPlacementBlock<T, Release, Counter> *control_block) {
+  init_data(control_block->get_data(), control_block);
+  ref_counted_link_self(data, control_block);
+}
+
+/**
+ * @brief Constructs a RefCountedPtr from a raw pointer.
+ *
+ * Takes ownership of the provided raw pointer and initializes the reference
+ * count to 1 by creating a new control block and incrementing its count.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param data The raw pointer to manage.
+ */
+template <typename T, typename Counter>
+constexpr RefCountedPtr<T, Counter>::RefCountedPtr(T *data) {
+  init_data(data,
+            new RefCountedPointerBlock<T, std::default_delete<T>, Counter>(
+                data, {}));
+  ref_counted_link_self(data, control_block);
+}
+
+/**
+ * @brief Constructs a RefCountedPtr from a raw pointer and a custom deleter.
+ *
+ * Takes ownership of the provided raw pointer and stores the deleter in a new
+ * control block, initializing the reference count to 1.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Deleter Callable invoked with the raw pointer on release.
+ * @param data The raw pointer to manage.
+ * @param deleter The deleter used to dispose of data.
+ */
+template <typename T, typename Counter>
+template <typename Deleter>
+constexpr RefCountedPtr<T, Counter>::RefCountedPtr(T *data, Deleter deleter) {
+  init_data(data, new RefCountedPointerBlock<T, Deleter, Counter>(
+                      data, std::move(deleter)));
+  ref_counted_link_self(data, control_block);
+}
+
+/**
+ * @brief Constructs a RefCountedPtr from a raw pointer without allocating a
+ * control block.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param lazy Tag selecting lazy allocation.
+ * @param data The raw pointer to manage.
+ */
+template <typename T, typename Counter>
+RefCountedPtr<T, Counter>::RefCountedPtr(RefCountedLazyTag, T *data)
+    : data(data), control_block(nullptr) {
+  static_assert(!std::is_void_v<T>,
+                "a lazily owned object is deleted through its own type");
+  if constexpr (decltype(ref_counted_link_self(data, control_block))::value) {
+    share();
+  }
+}
+
+/**
+ * @brief Aliasing constructor sharing ownership with another pointer.
+ *
+ * A lazily owned object gets its control block first, since it is about to
+ * be shared.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam U The type managed by the owner.
+ * @param owner The pointer whose ownership is shared.
+ * @param data The object this pointer refers to.
+ */
+template <typename T, typename Counter>
+template <typename U>
+RefCountedPtr<T, Counter>::RefCountedPtr(RefCountedPtr<U, Counter> &owner,
+                                         T *data) {
+  if constexpr (!std::is_array_v<U>) {
+    owner.share();
+  }
+  init_data(owner.control_block != nullptr ? data : nullptr,
+            owner.control_block);
+}
+
+/**
+ * @brief Aliasing constructor taking over ownership from another pointer.
+ *
+ * A lazily owned object gets its control block first, since the aliased
+ * pointer cannot delete it through data.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam U The type managed by the owner.
+ * @param owner The pointer to take ownership from.
+ * @param data The object this pointer refers to.
+ */
+template <typename T, typename Counter>
+template <typename U>
+RefCountedPtr<T, Counter>::RefCountedPtr(RefCountedPtr<U, Counter> &&owner,
+                                         T *data) {
+  if constexpr (!std::is_array_v<U>) {
+    owner.share();
+  }
+  this->data = owner.control_block != nullptr ? data : nullptr;
+  control_block = owner.control_block;
+  owner.data = nullptr;
+  owner.control_block = nullptr;
+}
+
+/**
+ * @brief Converting constructor sharing ownership with a pointer to a derived
+ * type.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam U A type whose pointer converts implicitly to T*.
+ * @param other The RefCountedPtr to share ownership with.
+ */
+template <typename T, typename Counter>
+template <typename U>
+  requires(std::is_convertible_v<U *, T *> && !std::is_same_v<U, T>)
+RefCountedPtr<T, Counter>::RefCountedPtr(RefCountedPtr<U, Counter> &other)
+    : RefCountedPtr(other, static_cast<T *>(other.data)) {}
+
+/**
+ * @brief Converting constructor taking over ownership from a pointer to a
+ * derived type without touching the reference count.
+ *
+ * A lazily owned object gets its control block first, because it must still
+ * be deleted as a U.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam U A type whose pointer converts implicitly to T*.
+ * @param other The RefCountedPtr to take ownership from; left empty.
+ */
+template <typename T, typename Counter>
+template <typename U>
+  requires(std::is_convertible_v<U *, T *> && !std::is_same_v<U, T>)
+RefCountedPtr<T, Counter>::RefCountedPtr(RefCountedPtr<U, Counter> &&other)
+    : RefCountedPtr(std::move(other), static_cast<T *>(other.data)) {}
+
+/**
+ * @brief Constructs a RefCountedPtr with variadic arguments.
+ *
+ * Creates a new object of T using the provided arguments inside a fused control
+ * block and initializes the reference count to 1.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param args Arguments forwarded to the T constructor.
+ */
+template <typename T, typename Counter>
+template <typename... Args>
+  requires(!ref_counted_is_self<RefCountedPtr<T, Counter>, Args...>)
+constexpr RefCountedPtr<T, Counter>::RefCountedPtr(Args &&...args)
+    : RefCountedPtr(ref_counted_packed, std::forward<Args>(args)...) {}
+
+/**
+ * @brief Constructs a RefCountedPtr with a chosen control block layout.
+ *
+ * Creates a new object of T using the provided arguments inside a fused control
+ * block with the requested layout and initializes the reference count to 1.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Layout The memory layout of the control block.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param layout Tag selecting the layout.
+ * @param args Arguments forwarded to the T constructor.
+ */
+template <typename T, typename Counter>
+template <RefCountedLayout Layout, typename... Args>
+constexpr RefCountedPtr<T, Counter>::RefCountedPtr(RefCountedLayoutTag<Layout>,
+                                                   Args &&...args) {
+  if (std::is_constant_evaluated()) {
+    // Inplace blocks need placement and aligned allocation, which constant
+    // evaluation does not allow; the layout makes no difference there.
+    T *object = new T(std::forward<Args>(args)...);
+    init_data(object,
+              new RefCountedPointerBlock<T, std::default_delete<T>, Counter>(
+                  object, {}));
+  } else {
+    RefCountedInplaceBlock<T, Layout, Counter> *block =
+        new RefCountedInplaceBlock<T, Layout, Counter>(
+            std::forward<Args>(args)...);
+    init_data(block->get_data(), block);
+  }
+  ref_counted_link_self(data, control_block);
+}
+
+/**
+ * @brief Copy constructor for sharing ownership.
+ *
+ * Shares ownership of the managed object and reference count with another
+ * RefCountedPtr, incrementing the reference count atomically.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param other The RefCountedPtr to share ownership with.
+ */
+template <typename T, typename Counter>
+constexpr RefCountedPtr<T, Counter>::RefCountedPtr(
+    RefCountedPtr<T, Counter> &other) {
+  other.share();
+  init_data(other.data, other.control_block);
+}
+
+/**
+ * @brief Move constructor transferring ownership.
+ *
+ * Takes over the managed object and control block of another RefCountedPtr
+ * without touching the reference count, leaving the source empty.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param other The RefCountedPtr to take ownership from.
+ */
+template <typename T, typename Counter>
+constexpr RefCountedPtr<T, Counter>::RefCountedPtr(
+    RefCountedPtr<T, Counter> &&other) noexcept
+    : data(other.data), control_block(other.control_block) {
+  other.data = nullptr;
+  other.control_block = nullptr;
+}
+
+/**
+ * @brief Destructor that manages resource cleanup.
+ *
+ * Decrements the reference count atomically. If the count reaches zero after
+ * decrementing, releases the managed object through its control block.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+constexpr RefCountedPtr<T, Counter>::~RefCountedPtr() {
+  release_reference();
+}
+
+/**
+ * @brief Assignment operator for sharing ownership.
+ *
+ * Releases the currently managed object (if any) by decrementing its reference
+ * count, then shares ownership with another RefCountedPtr, incrementing the new
+ * reference count.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param other The RefCountedPtr to assign from.
+ * @return RefCountedPtr<T, Counter>& Reference to this RefCountedPtr.
+ */
+template <typename T, typename Counter>
+constexpr RefCountedPtr<T, Counter> &
+RefCountedPtr<T, Counter>::operator=(RefCountedPtr<T, Counter> &other) {
+  if (this != &other) {
+    other.share();
+
+    // Release current resources
+    release_reference();
+
+    // Take on the new reference
+    this->data = other.data;
+    this->control_block = other.control_block;
+    if (control_block != nullptr) {
+      control_block->add_reference();
+    }
+  }
+  return *this;
+}
+
+/**
+ * @brief Move assignment operator transferring ownership.
+ *
+ * Releases the currently managed object (if any), then takes over the object
+ * and control block of another RefCountedPtr, leaving the source empty.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param other The RefCountedPtr to take ownership from.
+ * @return RefCountedPtr<T, Counter>& Reference to this RefCountedPtr.
+ */
+template <typename T, typename Counter>
+constexpr RefCountedPtr<T, Counter> &RefCountedPtr<T, Counter>::operator=(
+    RefCountedPtr<T, Counter> &&other) noexcept {
+  if (this != &other) {
+    // Release current resources
+    release_reference();
+
+    // Take over the other reference
+    data = other.data;
+    control_block = other.control_block;
+    other.data = nullptr;
+    other.control_block = nullptr;
+  }
+  return *this;
+}
+
+/**
+ * @brief Takes back unique ownership if this is the only reference.
+ *
+ * The acquire load pairs with the release of every other reference, so the
+ * caller sees all their writes to the object. No reference can appear
+ * concurrently, because copying requires an existing one. An object derived
+ * from EnableRefCountedFromThis is unlinked from its block, so ref_from_this()
+ * returns an empty pointer until the unique pointer is promoted again.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @return RefCountedUniquePtr<T, Counter> The object, or an empty pointer if
+ * it is shared.
+ */
+template <typename T, typename Counter>
+RefCountedUniquePtr<T, Counter> RefCountedPtr<T, Counter>::try_unique() {
+  if (data != nullptr && !is_unique()) {
+    return RefCountedUniquePtr<T, Counter>();
+  }
+  if (control_block != nullptr) {
+    RefCountedControlBlock<Counter> *unlinked = nullptr;
+    ref_counted_link_self(data, unlinked);
+  }
+  RefCountedUniquePtr<T, Counter> unique(data, control_block);
+  data = nullptr;
+  control_block = nullptr;
+  return unique;
+}
+
+/**
+ * @brief Retrieves the number of pointers sharing the managed object.
+ *
+ * A lazily owned object has no control block and exactly one owner.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @return std::size_t The number of owners, or 0 if no object is managed.
+ */
+template <typename T, typename Counter>
+std::size_t RefCountedPtr<T, Counter>::use_count() {
+  if (control_block == nullptr) {
+    return data != nullptr ? 1 : 0;
+  }
+  return static_cast<std::size_t>(
+      Counter::load(control_block->shared_references));
+}
+
+/**
+ * @brief Checks whether this is the only pointer to the managed object.
+ *
+ * Every counter maximum is above 1, so a plain acquire load answers this
+ * without consulting the overflow table. Blocks made by from_shared or
+ * to_shared are only asked about their std::shared_ptr owners once the count
+ * is 1.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @return bool True if an object is managed and no other pointer shares it.
+ */
+template <typename T, typename Counter>
+bool RefCountedPtr<T, Counter>::is_unique() {
+  if (control_block == nullptr) {
+    return data != nullptr;
+  }
+  return control_block->shared_references.load(std::memory_order_acquire) ==
+             1 &&
+         !control_block->has_external_owners();
+}
+
+/**
+ * @brief Prepares the managed object for modification (copy on write).
+ *
+ * The copy is made with the variadic constructor, so it shares one
+ * allocation with its new control block, unless T provides its own
+ * ref_counted_clone. The typeid check keeps a pointer to a polymorphic base
+ * from silently slicing a derived object.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @return T* The object, now owned only by this pointer, or nullptr if no
+ * object is managed.
+ */
+template <typename T, typename Counter>
+T *RefCountedPtr<T, Counter>::make_mutable() {
+  if (data == nullptr || is_unique()) {
+    return data;
+  }
+  if constexpr (requires(T &object) {
+                  {
+                    object.ref_counted_clone()
+                  } -> std::convertible_to<RefCountedPtr<T, Counter>>;
+                }) {
+    *this = RefCountedPtr<T, Counter>(data->ref_counted_clone());
+  } else {
+    if constexpr (std::is_polymorphic_v<T> && !std::is_final_v<T>) {
+      if (typeid(*data) != typeid(T)) {
+        throw std::bad_cast();
+      }
+    }
+    *this = RefCountedPtr<T, Counter>(*data);
+  }
+  return data;
+}
+
+/**
+ * @brief Blocks until this is the only pointer to the managed object.
+ *
+ * A std::shared_ptr owner can still hand out new references through
+ * from_shared, so the count is checked again after every poll. Waiting on an
+ * immortal object is a deadlock, which debug builds report and abort on.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+void RefCountedPtr<T, Counter>::wait_until_unique() {
+  if (control_block == nullptr) {
+    return;
+  }
+#ifndef NDEBUG
+  if (control_block->is_immortal()) {
+    std::fputs("RefCountedPtr: wait_until_unique on an immortal object never "
+               "returns\n",
+               stderr);
+    std::abort();
+  }
+#endif
+  while (true) {
+    control_block->wait_for_count(1);
+    if (!control_block->has_external_owners()) {
+      return;
+    }
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * @brief Blocks until every other pointer has dropped the managed object,
+ * then releases it on this thread.
+ *
+ * An immortal object has nothing to wait for, so only the reference is
+ * dropped.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+void RefCountedPtr<T, Counter>::wait_until_released() {
+  if (control_block == nullptr || !control_block->is_immortal()) {
+    wait_until_unique();
+  }
+  release_reference();
+  data = nullptr;
+  control_block = nullptr;
+}
+
+/**
+ * @brief Converts to a std::shared_ptr sharing ownership of the object.
+ *
+ * A block that already wraps a std::shared_ptr yields an aliasing copy of
+ * it, so a round trip through from_shared costs no allocation. A lazily
+ * owned object is handed to a RefCountedBridgeBlock instead of getting a
+ * control block of its own, which then serves every later call.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @return std::shared_ptr<T> Pointer to the object, or an empty one if no
+ * object is managed.
+ */
+template <typename T, typename Counter>
+std::shared_ptr<T> RefCountedPtr<T, Counter>::to_shared() {
+  if (data == nullptr) {
+    return nullptr;
+  }
+  if constexpr (!std::is_void_v<T>) {
+    if (control_block == nullptr) {
+      std::shared_ptr<T> shared(data, RefCountedBridgeBlock<T, Counter>());
+      RefCountedBridgeBlock<T, Counter> *bridge =
+          std::get_deleter<RefCountedBridgeBlock<T, Counter>>(shared);
+      bridge->adopt(shared);
+      control_block = bridge;
+      ref_counted_link_self(data, control_block);
+      return shared;
+    }
+  }
+  std::shared_ptr<const void> owner = control_block->get_shared_owner();
+  if (owner != nullptr) {
+    return std::shared_ptr<T>(std::move(owner), data);
+  }
+  return std::shared_ptr<T>(data, RefCountedSharedDeleter<Counter>{
+                                      RefCountedPtr<const void, Counter>(
+                                          *this)});
+}
+
+/**
+ * @brief Converts a std::shared_ptr to a RefCountedPtr sharing ownership of
+ * its object.
+ *
+ * A std::shared_ptr made by to_shared carries a RefCountedSharedDeleter or a
+ * RefCountedBridgeBlock whose reference is shared directly, so a round trip
+ * costs no allocation. A bridge whose RefCountedPtr instances are all gone
+ * is not revived, and gets wrapped like any other std::shared_ptr.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param shared The std::shared_ptr to share ownership with.
+ * @return RefCountedPtr<T, Counter> Pointer to the object, or an empty one if
+ * shared holds nullptr.
+ */
+template <typename T, typename Counter>
+RefCountedPtr<T, Counter>
+RefCountedPtr<T, Counter>::from_shared(std::shared_ptr<T> shared) {
+  RefCountedPtr<T, Counter> pointer;
+  T *data = shared.get();
+  if (data == nullptr) {
+    return pointer;
+  }
+  if (RefCountedSharedDeleter<Counter> *deleter =
+          std::get_deleter<RefCountedSharedDeleter<Counter>>(shared)) {
+    pointer.init_data(data, deleter->owner.control_block);
+    return pointer;
+  }
+  if constexpr (!std::is_void_v<T>) {
+    RefCountedBridgeBlock<T, Counter> *bridge =
+        std::get_deleter<RefCountedBridgeBlock<T, Counter>>(shared);
+    if (bridge != nullptr && bridge->try_add_reference()) {
+      pointer.data = data;
+      pointer.control_block = bridge;
+      return pointer;
+    }
+  }
+  pointer.init_data(data,
+                    new RefCountedSharedBlock<Counter>(std::move(shared)));
+  return pointer;
+}
+
+/**
+ * @brief Initializes the array pointer with its elements and array block.
+ *
+ * Increments the reference count of the block, if any, to reflect the new
+ * ownership.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @param data Pointer to the first element.
+ * @param control_block Pointer to the fused array block.
+ */
+template <typename T, typename Counter>
+void RefCountedPtr<T[], Counter>::init_data(
+    T *data, RefCountedArrayBlock<T, Counter> *control_block) {
+  this->data = data;
+  this->control_block = control_block;
+  if (control_block != nullptr) {
+    Counter::increment(control_block->shared_references);
+  }
+}
+
+/**
+ * @brief Releases the elements and their array block.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+void RefCountedPtr<T[], Counter>::release_data() {
+  control_block->check_borrows();
+  control_block->release_data();
+}
+
+/**
+ * @brief Drops this pointer's reference, releasing the array if it was the
+ * last one.
+ *
+ * Like the scalar pointer, a release that leaves other owners wakes threads
+ * waiting for the count to drop, such as an aliasing pointer into the array
+ * blocked in wait_until_unique().
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+void RefCountedPtr<T[], Counter>::release_reference() {
+  if (control_block != nullptr) {
+    if (Counter::decrement(control_block->shared_references)) {
+      release_data();
+    } else {
+      RefCountedControlBlock<Counter>::notify_release();
+    }
+  }
+}
+
+/**
+ * @brief Constructs a RefCountedPtr from a freshly created array block.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @param control_block The array block to manage.
+ */
+template <typename T, typename Counter>
+RefCountedPtr<T[], Counter>::RefCountedPtr(
+    RefCountedArrayBlock<T, Counter> *control_block) {
+  init_data(control_block->get_data(), control_block);
+}
+
+/**
+ * @brief Copy constructor for sharing ownership of the array.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @param other The RefCountedPtr to share ownership with.
+ */
+template <typename T, typename Counter>
+RefCountedPtr<T[], Counter>::RefCountedPtr(RefCountedPtr<T[], Counter> &other) {
+  init_data(other.data, other.control_block);
+}
+
+/**
+ * @brief Move constructor transferring ownership of the array.
+ *
+ * Takes over the elements and block of another RefCountedPtr without touching
+ * the reference count, leaving the source empty.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @param other The RefCountedPtr to take ownership from.
+ */
+template <typename T, typename Counter>
+RefCountedPtr<T[], Counter>::RefCountedPtr(
+    RefCountedPtr<T[], Counter> &&other) noexcept
+    : data(other.data), control_block(other.control_block) {
+  other.data = nullptr;
+  other.control_block = nullptr;
+}
+
+/**
+ * @brief Destructor that releases the array when no references remain.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+RefCountedPtr<T[], Counter>::~RefCountedPtr() {
+  release_reference();
+}
+
+/**
+ * @brief Retrieves the pointer to the first element.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @return T* The first element, or nullptr if no array is managed.
+ */
+template <typename T, typename Counter>
+T *RefCountedPtr<T[], Counter>::get_data() {
+  return data;
+}
+
+/**
+ * @brief Retrieves the number of elements in the managed array.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @return std::size_t The number of elements, or 0 if no array is managed.
+ */
+template <typename T, typename Counter>
+std::size_t RefCountedPtr<T[], Counter>::get_length() {
+  return control_block != nullptr ? control_block->get_length() : 0;
+}
+
+/**
+ * @brief Retrieves a span over the managed elements.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @return std::span<T> Span covering every element of the array.
+ */
+template <typename T, typename Counter>
+std::span<T> RefCountedPtr<T[], Counter>::get_span() {
+  return std::span<T>(data, get_length());
+}
+
+/**
+ * @brief Accesses an element without bounds checking.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @param index Index of the element.
+ * @return T& Reference to the element.
+ */
+template <typename T, typename Counter>
+T &RefCountedPtr<T[], Counter>::operator[](std::size_t index) {
+  return data[index];
+}
+
+/**
+ * @brief Retrieves the number of pointers sharing the managed array.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @return std::size_t The number of owners, or 0 if no array is managed.
+ */
+template <typename T, typename Counter>
+std::size_t RefCountedPtr<T[], Counter>::use_count() {
+  if (control_block == nullptr) {
+    return 0;
+  }
+  return static_cast<std::size_t>(
+      Counter::load(control_block->shared_references));
+}
+
+/**
+ * @brief Checks whether this is the only pointer to the managed array.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @return bool True if an array is managed and no other pointer shares it.
+ */
+template <typename T, typename Counter>
+bool RefCountedPtr<T[], Counter>::is_unique() {
+  return control_block != nullptr &&
+         control_block->shared_references.load(std::memory_order_acquire) ==
+             1;
+}
+
+/**
+ * @brief Assignment operator for sharing ownership of the array.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @param other The RefCountedPtr to assign from.
+ * @return RefCountedPtr<T[], Counter>& Reference to this RefCountedPtr.
+ */
+template <typename T, typename Counter>
+RefCountedPtr<T[], Counter> &
+RefCountedPtr<T[], Counter>::operator=(RefCountedPtr<T[], Counter> &other) {
+  if (this != &other) {
+    // Release current resources
+    release_reference();
+
+    // Take on the new reference
+    init_data(other.data, other.control_block);
+  }
+  return *this;
+}
+
+/**
+ * @brief Move assignment operator transferring ownership of the array.
+ *
+ * Releases the currently managed array (if any), then takes over the elements
+ * and block of another RefCountedPtr, leaving the source empty.
+ *
+ * @tparam T The element type of the managed array.
+ * @tparam Counter The reference count policy.
+ * @param other The RefCountedPtr to take ownership from.
+ * @return RefCountedPtr<T[], Counter>& Reference to this RefCountedPtr.
+ */
+template <typename T, typename Counter>
+RefCountedPtr<T[], Counter> &RefCountedPtr<T[], Counter>::operator=(
+    RefCountedPtr<T[], Counter> &&other) noexcept {
+  if (this != &other) {
+    // Release current resources
+    release_reference();
+
+    // Take over the other reference
+    data = other.data;
+    control_block = other.control_block;
+    other.data = nullptr;
+    other.control_block = nullptr;
+  }
+  return *this;
+}
+
+/**
+ * @brief Creates a shared array of the given length in a single allocation.
+ *
+ * @tparam T The element type.
+ * @tparam Alignment Minimum alignment of the first element, a power of two.
+ * @tparam Counter The reference count policy.
+ * @tparam Args Either empty or a single value to copy into every element.
+ * @param length Number of elements.
+ * @param args Optional value to initialize the elements with.
+ * @return RefCountedPtr<T[], Counter> Pointer owning the new array.
+ */
+template <typename T, std::size_t Alignment, typename Counter, typename... Args>
+RefCountedPtr<T[], Counter> make_ref_counted_array(std::size_t length,
+                                                   const Args &...args) {
+  static_assert((Alignment & (Alignment - 1)) == 0,
+                "alignment must be a power of two");
+  return RefCountedPtr<T[], Counter>(
+      RefCountedArrayBlock<T, Counter>::create(length, Alignment, args...));
+}
+
+/**
+ * @brief Creates a shared object inside caller-provided storage, without
+ * calling the heap allocator.
  *
  * @tparam T The type of the managed object.
- * @param data Pointer to the object to manage.
- * @param shared_references Pointer to the atomic reference count.
+ * @tparam Counter The reference count policy.
+ * @tparam Release Callable invoked with the storage address.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param storage Start of the storage.
+ * @param size Size of the storage in bytes.
+ * @param release Callable invoked with storage once the object is released.
+ * @param args Arguments forwarded to the T constructor.
+ * @return RefCountedPtr<T, Counter> Pointer owning the new object.
  */
-template <typename T>
-void RefCountedPtr<T>::init_data(T *data, std::atomic<int> *shared_references) {
-  this->data = data;
-  this->shared_references = shared_references;
-  this->shared_references->fetch_add(1, std::memory_order_relaxed);
+template <typename T, typename Counter, typename Release, typename... Args>
+RefCountedPtr<T, Counter> make_ref_counted_in(void *storage, std::size_t size,
+                                              Release release,
+                                              Args &&...args) {
+  return RefCountedPtr<T, Counter>(
+      RefCountedPlacementBlock<T, Release, Counter>::create(
+          storage, size, std::move(release), std::forward<Args>(args)...));
 }
 
 /**
- * @brief Releases the managed object and its reference count.
+ * @brief Initializes the handle with the given control block.
  *
- * Deletes the managed object and the reference count when no references remain.
+ * Increments the reference count of the block, if any, to reflect the new
+ * ownership.
  *
  * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param control_block Pointer to the fused control block.
  */
-template <typename T> void RefCountedPtr<T>::release_data() {
-  delete data;
-  delete shared_references;
+template <typename T, typename Counter>
+void RefCountedHandle<T, Counter>::init_data(
+    RefCountedInplaceBlock<T, RefCountedLayout::Packed, Counter>
+        *control_block) {
+  this->control_block = control_block;
+  if (control_block != nullptr) {
+    Counter::increment(control_block->shared_references);
+  }
+}
+
+/**
+ * @brief Drops this handle's reference, releasing the block if it was the last
+ * one.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+void RefCountedHandle<T, Counter>::release_reference() {
+  if (control_block != nullptr) {
+    if (Counter::decrement(control_block->shared_references)) {
+      control_block->check_borrows();
+      control_block->release_data();
+    } else {
+      RefCountedControlBlock<Counter>::notify_release();
+    }
+  }
+}
+
+/**
+ * @brief Constructs a handle with variadic arguments.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param args Arguments forwarded to the T constructor.
+ */
+template <typename T, typename Counter>
+template <typename... Args>
+  requires(!ref_counted_is_self<RefCountedHandle<T, Counter>, Args...>)
+RefCountedHandle<T, Counter>::RefCountedHandle(Args &&...args) {
+  init_data(new RefCountedInplaceBlock<T, RefCountedLayout::Packed, Counter>(
+      std::forward<Args>(args)...));
+  ref_counted_link_self(get_data(), control_block);
+}
+
+/**
+ * @brief Copy constructor for sharing ownership.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param other The handle to share ownership with.
+ */
+template <typename T, typename Counter>
+RefCountedHandle<T, Counter>::RefCountedHandle(
+    RefCountedHandle<T, Counter> &other) {
+  init_data(other.control_block);
+}
+
+/**
+ * @brief Move constructor transferring ownership without touching the count.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param other The handle to take ownership from; left empty.
+ */
+template <typename T, typename Counter>
+RefCountedHandle<T, Counter>::RefCountedHandle(
+    RefCountedHandle<T, Counter> &&other) noexcept
+    : control_block(other.control_block) {
+  other.control_block = nullptr;
+}
+
+/**
+ * @brief Destructor that releases the object when no references remain.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+RefCountedHandle<T, Counter>::~RefCountedHandle() {
+  release_reference();
 }
 
 /**
  * @brief Retrieves the raw pointer to the managed object.
  *
- * Provides direct access to the underlying object, returning nullptr if no
- * object is managed.
+ * The object sits at a fixed offset inside the control block, so this is a
+ * single address computation.
  *
  * @tparam T The type of the managed object.
- * @return T* The raw pointer to the managed object.
+ * @tparam Counter The reference count policy.
+ * @return T* The managed object, or nullptr if the handle is empty.
  */
-template <typename T> T *RefCountedPtr<T>::get_data() { return data; }
+template <typename T, typename Counter>
+T *RefCountedHandle<T, Counter>::get_data() {
+  return control_block != nullptr ? control_block->get_data() : nullptr;
+}
 
 /**
- * @brief Constructs a RefCountedPtr from a raw pointer.
+ * @brief Creates a RefCountedPtr sharing this handle's control block.
  *
- * Takes ownership of the provided raw pointer and initializes the reference
- * count to 1 by creating a new atomic counter and incrementing it.
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @return RefCountedPtr<T, Counter> Pointer sharing ownership with this
+ * handle.
+ */
+template <typename T, typename Counter>
+RefCountedPtr<T, Counter> RefCountedHandle<T, Counter>::get_ptr() {
+  RefCountedPtr<T, Counter> pointer;
+  pointer.init_data(get_data(), control_block);
+  return pointer;
+}
+
+/**
+ * @brief Assignment operator for sharing ownership.
  *
  * @tparam T The type of the managed object.
- * @param data The raw pointer to manage.
+ * @tparam Counter The reference count policy.
+ * @param other The handle to assign from.
+ * @return RefCountedHandle<T, Counter>& Reference to this handle.
  */
-template <typename T> RefCountedPtr<T>::RefCountedPtr(T *data) {
-  init_data(data, new std::atomic<int>(0));
+template <typename T, typename Counter>
+RefCountedHandle<T, Counter> &
+RefCountedHandle<T, Counter>::operator=(RefCountedHandle<T, Counter> &other) {
+  if (this != &other) {
+    release_reference();
+    init_data(other.control_block);
+  }
+  return *this;
 }
 
 /**
- * @brief Constructs a RefCountedPtr with variadic arguments.
+ * @brief Move assignment operator transferring ownership.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param other The handle to take ownership from; left empty.
+ * @return RefCountedHandle<T, Counter>& Reference to this handle.
+ */
+template <typename T, typename Counter>
+RefCountedHandle<T, Counter> &RefCountedHandle<T, Counter>::operator=(
+    RefCountedHandle<T, Counter> &&other) noexcept {
+  if (this != &other) {
+    release_reference();
+    control_block = other.control_block;
+    other.control_block = nullptr;
+  }
+  return *this;
+}
+
+/**
+ * @brief Disposes of the managed object, if any.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ */
+template <typename T, typename Counter>
+void RefCountedUniquePtr<T, Counter>::release_data() {
+  if (control_block != nullptr) {
+    control_block->check_borrows();
+    control_block->release_data();
+  } else {
+    delete data;
+  }
+}
+
+/**
+ * @brief Takes over an object and its control block.
+ *
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param data Pointer to the managed object.
+ * @param control_block Reserved control block, or nullptr.
+ */
+template <typename T, typename Counter>
+RefCountedUniquePtr<T, Counter>::RefCountedUniquePtr(
+    T *data, RefCountedControlBlock<Counter> *control_block)
+    : data(data), control_block(control_block) {}
+
+/**
+ * @brief Constructs the object and its control block in one allocation.
  *
- * Creates a new object of T using the provided arguments and initializes the
- * reference count to 1 by creating a new atomic counter and incrementing it.
+ * The reference count stays at zero until the pointer is promoted.
  *
  * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
  * @tparam Args Variadic template for constructor arguments.
  * @param args Arguments forwarded to the T constructor.
  */
-template <typename T>
+template <typename T, typename Counter>
 template <typename... Args>
-RefCountedPtr<T>::RefCountedPtr(Args &&...args) {
-  init_data(new T(std::forward<Args>(args)...), new std::atomic<int>(0));
+  requires(!ref_counted_is_self<RefCountedUniquePtr<T, Counter>, Args...>)
+RefCountedUniquePtr<T, Counter>::RefCountedUniquePtr(Args &&...args) {
+  RefCountedInplaceBlock<T, RefCountedLayout::Packed, Counter> *block =
+      new RefCountedInplaceBlock<T, RefCountedLayout::Packed, Counter>(
+          std::forward<Args>(args)...);
+  data = block->get_data();
+  control_block = block;
 }
 
 /**
- * @brief Copy constructor for sharing ownership.
+ * @brief Move constructor transferring ownership.
  *
- * Shares ownership of the managed object and reference count with another
- * RefCountedPtr, incrementing the reference count atomically.
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to take ownership from; left empty.
+ */
+template <typename T, typename Counter>
+RefCountedUniquePtr<T, Counter>::RefCountedUniquePtr(
+    RefCountedUniquePtr<T, Counter> &&other) noexcept
+    : data(other.data), control_block(other.control_block) {
+  other.data = nullptr;
+  other.control_block = nullptr;
+}
+
+/**
+ * @brief Destructor that destroys the object.
  *
  * @tparam T The type of the managed object.
- * @param other The RefCountedPtr to share ownership with.
+ * @tparam Counter The reference count policy.
  */
-template <typename T> RefCountedPtr<T>::RefCountedPtr(RefCountedPtr<T> &other) {
-  init_data(other.data, other.shared_references);
+template <typename T, typename Counter>
+RefCountedUniquePtr<T, Counter>::~RefCountedUniquePtr() {
+  release_data();
 }
 
 /**
- * @brief Destructor that manages resource cleanup.
+ * @brief Retrieves the raw pointer to the managed object.
  *
- * Decrements the reference count atomically. If the count reaches zero after
- * decrementing, deletes the managed object and reference count.
+ * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @return T* The managed object, or nullptr if the pointer is empty.
+ */
+template <typename T, typename Counter>
+T *RefCountedUniquePtr<T, Counter>::get_data() {
+  return data;
+}
+
+/**
+ * @brief Converts unique ownership into shared ownership.
+ *
+ * The reserved control block gets its initial count with a plain store; no
+ * other thread can observe the block before the returned pointer is
+ * published. An object without a control block becomes a lazily owned
+ * RefCountedPtr.
  *
  * @tparam T The type of the managed object.
+ * @tparam Counter The reference count policy.
+ * @return RefCountedPtr<T, Counter> The only reference to the object.
  */
-template <typename T> RefCountedPtr<T>::~RefCountedPtr() {
-  if (shared_references != nullptr) {
-    if (shared_references->fetch_sub(1, std::memory_order_acq_rel) == 1) {
-      release_data();
-    }
+template <typename T, typename Counter>
+RefCountedPtr<T, Counter> RefCountedUniquePtr<T, Counter>::promote() {
+  RefCountedPtr<T, Counter> pointer;
+  pointer.data = data;
+  pointer.control_block = control_block;
+  if (control_block != nullptr) {
+    control_block->shared_references.store(1, std::memory_order_relaxed);
+    ref_counted_link_self(data, control_block);
   }
+  data = nullptr;
+  control_block = nullptr;
+  return pointer;
 }
 
 /**
- * @brief Assignment operator for sharing ownership.
- *
- * Releases the currently managed object (if any) by decrementing its reference
- * count, then shares ownership with another RefCountedPtr, incrementing the new
- * reference count.
+ * @brief Move assignment operator transferring ownership.
  *
  * @tparam T The type of the managed object.
- * @param other The RefCountedPtr to assign from.
- * @return RefCountedPtr<T>& Reference to this RefCountedPtr.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to take ownership from; left empty.
+ * @return RefCountedUniquePtr<T, Counter>& Reference to this pointer.
  */
-template <typename T>
-RefCountedPtr<T> &RefCountedPtr<T>::operator=(RefCountedPtr<T> &other) {
+template <typename T, typename Counter>
+RefCountedUniquePtr<T, Counter> &RefCountedUniquePtr<T, Counter>::operator=(
+    RefCountedUniquePtr<T, Counter> &&other) noexcept {
   if (this != &other) {
-    // Release current resources
-    if (shared_references != nullptr) {
-      if (shared_references->fetch_sub(1, std::memory_order_acq_rel) == 1) {
-        release_data();
-      }
+    release_data();
+    data = other.data;
+    control_block = other.control_block;
+    other.data = nullptr;
+    other.control_block = nullptr;
+  }
+  return *this;
+}
+
+/**
+ * @brief Casts a RefCountedPtr with static_cast, sharing its control block.
+ *
+ * @tparam T The target type.
+ * @tparam U The source type.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to share ownership with.
+ * @return RefCountedPtr<T, Counter> Pointer to the same object as T.
+ */
+template <typename T, typename U, typename Counter>
+RefCountedPtr<T, Counter>
+static_pointer_cast(RefCountedPtr<U, Counter> &other) {
+  return RefCountedPtr<T, Counter>(other, static_cast<T *>(other.get_data()));
+}
+
+/**
+ * @brief Casts a RefCountedPtr with static_cast, taking over its reference.
+ *
+ * @tparam T The target type.
+ * @tparam U The source type.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to take ownership from; left empty.
+ * @return RefCountedPtr<T, Counter> Pointer to the same object as T.
+ */
+template <typename T, typename U, typename Counter>
+RefCountedPtr<T, Counter>
+static_pointer_cast(RefCountedPtr<U, Counter> &&other) {
+  T *data = static_cast<T *>(other.get_data());
+  return RefCountedPtr<T, Counter>(std::move(other), data);
+}
+
+/**
+ * @brief Casts a RefCountedPtr with dynamic_cast, sharing its control block.
+ *
+ * @tparam T The target type.
+ * @tparam U The source type.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to share ownership with.
+ * @return RefCountedPtr<T, Counter> Pointer to the same object as T, or an
+ * empty pointer if the object is not a T.
+ */
+template <typename T, typename U, typename Counter>
+RefCountedPtr<T, Counter>
+dynamic_pointer_cast(RefCountedPtr<U, Counter> &other) {
+  T *data = dynamic_cast<T *>(other.get_data());
+  if (data == nullptr) {
+    return RefCountedPtr<T, Counter>();
+  }
+  return RefCountedPtr<T, Counter>(other, data);
+}
+
+/**
+ * @brief Casts a RefCountedPtr with dynamic_cast, taking over its reference
+ * if the cast succeeds.
+ *
+ * @tparam T The target type.
+ * @tparam U The source type.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to take ownership from; left untouched if the cast
+ * fails.
+ * @return RefCountedPtr<T, Counter> Pointer to the same object as T, or an
+ * empty pointer if the object is not a T.
+ */
+template <typename T, typename U, typename Counter>
+RefCountedPtr<T, Counter>
+dynamic_pointer_cast(RefCountedPtr<U, Counter> &&other) {
+  T *data = dynamic_cast<T *>(other.get_data());
+  if (data == nullptr) {
+    return RefCountedPtr<T, Counter>();
+  }
+  return RefCountedPtr<T, Counter>(std::move(other), data);
+}
+
+/**
+ * @brief Casts a RefCountedPtr with const_cast, sharing its control block.
+ *
+ * @tparam T The target type.
+ * @tparam U The source type.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to share ownership with.
+ * @return RefCountedPtr<T, Counter> Pointer to the same object as T.
+ */
+template <typename T, typename U, typename Counter>
+RefCountedPtr<T, Counter> const_pointer_cast(RefCountedPtr<U, Counter> &other) {
+  return RefCountedPtr<T, Counter>(other, const_cast<T *>(other.get_data()));
+}
+
+/**
+ * @brief Casts a RefCountedPtr with const_cast, taking over its reference.
+ *
+ * @tparam T The target type.
+ * @tparam U The source type.
+ * @tparam Counter The reference count policy.
+ * @param other The pointer to take ownership from; left empty.
+ * @return RefCountedPtr<T, Counter> Pointer to the same object as T.
+ */
+template <typename T, typename U, typename Counter>
+RefCountedPtr<T, Counter>
+const_pointer_cast(RefCountedPtr<U, Counter> &&other) {
+  T *data = const_cast<T *>(other.get_data());
+  return RefCountedPtr<T, Counter>(std::move(other), data);
+}
+
+/**
+ * @brief Registers this borrow with the control block, if tracking.
+ *
+ * @tparam T The type of the borrowed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Track Whether the borrow is counted.
+ */
+template <typename T, typename Counter, bool Track>
+void RefCountedRef<T, Counter, Track>::add_borrow() {
+  if constexpr (Track) {
+    if (control_block != nullptr) {
+      control_block->borrows.fetch_add(1, std::memory_order_relaxed);
     }
+  }
+}
 
-    // Take on the new reference
-    this->data = other.data;
-    this->shared_references = other.shared_references;
-    if (shared_references != nullptr) {
-      shared_references->fetch_add(1, std::memory_order_relaxed);
+/**
+ * @brief Unregisters this borrow from the control block, if tracking.
+ *
+ * @tparam T The type of the borrowed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Track Whether the borrow is counted.
+ */
+template <typename T, typename Counter, bool Track>
+void RefCountedRef<T, Counter, Track>::release_borrow() {
+  if constexpr (Track) {
+    if (control_block != nullptr) {
+      control_block->borrows.fetch_sub(1, std::memory_order_release);
     }
   }
+}
+
+/**
+ * @brief Borrows the object of a RefCountedPtr.
+ *
+ * @tparam T The type of the borrowed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Track Whether the borrow is counted.
+ * @param owner The pointer to borrow from.
+ */
+template <typename T, typename Counter, bool Track>
+RefCountedRef<T, Counter, Track>::RefCountedRef(
+    RefCountedPtr<T, Counter> &owner) {
+  owner.share();
+  data = owner.data;
+  control_block = owner.control_block;
+  add_borrow();
+}
+
+/**
+ * @brief Copy constructor creating another borrow of the same object.
+ *
+ * @tparam T The type of the borrowed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Track Whether the borrow is counted.
+ * @param other The borrow to copy.
+ */
+template <typename T, typename Counter, bool Track>
+RefCountedRef<T, Counter, Track>::RefCountedRef(
+    const RefCountedRef<T, Counter, Track> &other)
+    : data(other.data), control_block(other.control_block) {
+  add_borrow();
+}
+
+/**
+ * @brief Destructor that ends the borrow.
+ *
+ * @tparam T The type of the borrowed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Track Whether the borrow is counted.
+ */
+template <typename T, typename Counter, bool Track>
+RefCountedRef<T, Counter, Track>::~RefCountedRef() {
+  release_borrow();
+}
+
+/**
+ * @brief Retrieves the raw pointer to the borrowed object.
+ *
+ * @tparam T The type of the borrowed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Track Whether the borrow is counted.
+ * @return T* The borrowed object, or nullptr if the borrow is empty.
+ */
+template <typename T, typename Counter, bool Track>
+T *RefCountedRef<T, Counter, Track>::get_data() {
+  return data;
+}
+
+/**
+ * @brief Upgrades the borrow to an owning pointer.
+ *
+ * @tparam T The type of the borrowed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Track Whether the borrow is counted.
+ * @return RefCountedPtr<T, Counter> Pointer sharing ownership of the object.
+ */
+template <typename T, typename Counter, bool Track>
+RefCountedPtr<T, Counter> RefCountedRef<T, Counter, Track>::get_ptr() {
+  RefCountedPtr<T, Counter> pointer;
+  pointer.init_data(data, control_block);
+  return pointer;
+}
+
+/**
+ * @brief Assignment operator borrowing the object of another borrow.
+ *
+ * @tparam T The type of the borrowed object.
+ * @tparam Counter The reference count policy.
+ * @tparam Track Whether the borrow is counted.
+ * @param other The borrow to copy.
+ * @return RefCountedRef<T, Counter, Track>& Reference to this borrow.
+ */
+template <typename T, typename Counter, bool Track>
+RefCountedRef<T, Counter, Track> &
+RefCountedRef<T, Counter, Track>::operator=(
+    const RefCountedRef<T, Counter, Track> &other) {
+  if (this != &other) {
+    release_borrow();
+    data = other.data;
+    control_block = other.control_block;
+    add_borrow();
+  }
   return *this;
-}
\ No newline at end of file
+}
@@ -0,0 +1,249 @@
+#ifndef REFCOUNTEDRELOCATABLEHEAP_HEADER
+#define REFCOUNTEDRELOCATABLEHEAP_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Heap of reference-counted objects that can be moved to defragment
+ * memory.
+ *
+ * Objects live in fixed-size pages and are only reachable through a handle
+ * table, never through a long-lived raw pointer. Code that needs to touch an
+ * object pins it for the duration of the access. When no pins are held,
+ * compact() moves live objects from the back of the heap into holes at the
+ * front and frees the pages left empty, so reserved memory tracks live data
+ * instead of the peak.
+ *
+ * The heap is not thread-safe, and handles must not outlive it.
+ *
+ * T may still be incomplete where Handle is named, so objects can hold
+ * handles to objects of their own type, as graph nodes do.
+ *
+ * @tparam T The type of the stored objects; must be nothrow
+ * move-constructible so it can be relocated.
+ */
+template <typename T> class RefCountedRelocatableHeap {
+public:
+  /**
+   * @brief Scoped access to an object that keeps it from being relocated.
+   *
+   * A pin holds a reference like a Handle, so the pointer returned by get_data
+   * stays valid for the lifetime of the pin even if every handle is released.
+   */
+  class Pin {
+  private:
+    RefCountedRelocatableHeap<T> *heap; ///< The heap owning the object.
+    std::uint32_t entry;                ///< Handle table entry of the object.
+
+    friend class RefCountedRelocatableHeap<T>;
+
+    /**
+     * @brief Pins the object of a handle table entry and adds a reference to
+     * it.
+     *
+     * @param heap The heap owning the object.
+     * @param entry Handle table entry of the object.
+     */
+    Pin(RefCountedRelocatableHeap<T> *, std::uint32_t);
+
+  public:
+    Pin(const Pin &) = delete;
+    Pin &operator=(const Pin &) = delete;
+
+    /**
+     * @brief Move constructor transferring the pin.
+     *
+     * @param other The pin to take over; left empty.
+     */
+    Pin(Pin &&) noexcept;
+
+    /**
+     * @brief Destructor that releases the pin and its reference.
+     */
+    ~Pin();
+
+    /**
+     * @brief Retrieves the pinned object.
+     *
+     * @return T* The object, or nullptr if the pin is empty.
+     */
+    T *get_data();
+  };
+
+  /**
+   * @brief Owning reference to an object in the heap.
+   *
+   * Copies share ownership; the object is destroyed when the last Handle is
+   * released. Access goes through pin().
+   */
+  class Handle {
+  private:
+    RefCountedRelocatableHeap<T> *heap; ///< The heap owning the object.
+    std::uint32_t entry;                ///< Handle table entry of the object.
+
+    /**
+     * @brief Drops this handle's reference, if any.
+     */
+    void release_reference();
+
+    friend class RefCountedRelocatableHeap<T>;
+
+    /**
+     * @brief Constructs a handle and adds a reference to its entry.
+     *
+     * @param heap The heap owning the object.
+     * @param entry Handle table entry of the object.
+     */
+    Handle(RefCountedRelocatableHeap<T> *, std::uint32_t);
+
+  public:
+    /**
+     * @brief Default constructor creating an empty handle.
+     */
+    Handle() : heap(nullptr), entry(0) {}
+
+    /**
+     * @brief Copy constructor for sharing ownership.
+     *
+     * @param other The handle to share ownership with.
+     */
+    Handle(Handle &);
+
+    /**
+     * @brief Move constructor transferring ownership.
+     *
+     * @param other The handle to take ownership from; left empty.
+     */
+    Handle(Handle &&) noexcept;
+
+    /**
+     * @brief Destructor that releases the object when no references remain.
+     */
+    ~Handle();
+
+    /**
+     * @brief Pins the object so it can be accessed.
+     *
+     * @return Pin Scoped access to the object; empty if the handle is empty.
+     */
+    Pin pin();
+
+    /**
+     * @brief Assignment operator for sharing ownership.
+     *
+     * @param other The handle to assign from.
+     * @return Handle& Reference to this handle.
+     */
+    Handle &operator=(Handle &);
+
+    /**
+     * @brief Move assignment operator transferring ownership.
+     *
+     * @param other The handle to take ownership from; left empty.
+     * @return Handle& Reference to this handle.
+     */
+    Handle &operator=(Handle &&) noexcept;
+  };
+
+private:
+  /**
+   * @brief Handle table entry tracking one live object.
+   */
+  struct Entry {
+    std::uint32_t slot;  ///< Global slot the object currently occupies.
+    std::uint32_t count; ///< Number of handles and pins referencing it.
+    std::uint32_t pins;  ///< Number of pins held on the object.
+  };
+
+  static constexpr std::uint32_t no_entry =
+      std::numeric_limits<std::uint32_t>::max(); ///< Owner of a free slot.
+
+  std::size_t objects_per_page;            ///< Slots in every page.
+  std::vector<T *> pages;                  ///< Storage of every page.
+  std::vector<std::uint32_t> slot_owners;  ///< Entry owning each slot.
+  std::vector<std::uint32_t> free_slots;   ///< Free slots ready for reuse.
+  std::vector<Entry> entries;              ///< The handle table.
+  std::vector<std::uint32_t> free_entries; ///< Unused handle table entries.
+  std::size_t pins;                        ///< Pins held across the heap.
+
+  /**
+   * @brief Computes the address of a global slot.
+   *
+   * @param slot The global slot number.
+   * @return T* Address of the slot's storage.
+   */
+  T *slot_address(std::uint32_t);
+
+  /**
+   * @brief Allocates a new page and adds its slots to the free list.
+   */
+  void add_page();
+
+  /**
+   * @brief Removes a reference, destroying the object and freeing its slot
+   * and entry when it was the last one.
+   *
+   * @param entry Handle table entry of the object.
+   */
+  void release_reference(std::uint32_t);
+
+public:
+  /**
+   * @brief Constructs an empty heap.
+   *
+   * Throws std::invalid_argument if objects_per_page is zero.
+   *
+   * @param objects_per_page Number of objects stored in each page.
+   */
+  explicit RefCountedRelocatableHeap(std::size_t objects_per_page = 64);
+
+  RefCountedRelocatableHeap(const RefCountedRelocatableHeap<T> &) = delete;
+  RefCountedRelocatableHeap<T> &
+  operator=(const RefCountedRelocatableHeap<T> &) = delete;
+
+  /**
+   * @brief Destroys every remaining object and frees all pages.
+   */
+  ~RefCountedRelocatableHeap();
+
+  /**
+   * @brief Constructs a new object in a free slot.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param args Arguments to pass to the T constructor.
+   * @return Handle The only owning reference to the new object.
+   */
+  template <typename... Args> Handle create(Args &&...);
+
+  /**
+   * @brief Moves live objects into dense pages and frees empty pages.
+   *
+   * Does nothing while any object is pinned.
+   *
+   * @return std::size_t Number of bytes of page storage released.
+   */
+  std::size_t compact();
+
+  /**
+   * @brief Retrieves the number of live objects.
+   *
+   * @return std::size_t The number of live objects.
+   */
+  std::size_t size();
+
+  /**
+   * @brief Retrieves the number of bytes reserved for page storage.
+   *
+   * @return std::size_t Bytes held by all pages.
+   */
+  std::size_t get_reserved_bytes();
+};
+
+#include "RefCountedRelocatableHeap.tpp"
+
+#endif
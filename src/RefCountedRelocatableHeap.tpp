@@ -0,0 +1,387 @@
+#include "RefCountedRelocatableHeap.h"
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Pins the object of a handle table entry and adds a reference to it.
+ *
+ * @tparam T The type of the stored objects.
+ * @param heap The heap owning the object.
+ * @param entry Handle table entry of the object.
+ */
+template <typename T>
+RefCountedRelocatableHeap<T>::Pin::Pin(RefCountedRelocatableHeap<T> *heap,
+                                       std::uint32_t entry)
+    : heap(heap), entry(entry) {
+  if (heap != nullptr) {
+    ++heap->entries[entry].count;
+    ++heap->entries[entry].pins;
+    ++heap->pins;
+  }
+}
+
+/**
+ * @brief Move constructor transferring the pin.
+ *
+ * @tparam T The type of the stored objects.
+ * @param other The pin to take over; left empty.
+ */
+template <typename T>
+RefCountedRelocatableHeap<T>::Pin::Pin(Pin &&other) noexcept
+    : heap(other.heap), entry(other.entry) {
+  other.heap = nullptr;
+}
+
+/**
+ * @brief Destructor that releases the pin and its reference.
+ *
+ * @tparam T The type of the stored objects.
+ */
+template <typename T> RefCountedRelocatableHeap<T>::Pin::~Pin() {
+  if (heap != nullptr) {
+    --heap->entries[entry].pins;
+    --heap->pins;
+    heap->release_reference(entry);
+  }
+}
+
+/**
+ * @brief Retrieves the pinned object.
+ *
+ * @tparam T The type of the stored objects.
+ * @return T* The object, or nullptr if the pin is empty.
+ */
+template <typename T> T *RefCountedRelocatableHeap<T>::Pin::get_data() {
+  return heap != nullptr ? heap->slot_address(heap->entries[entry].slot)
+                         : nullptr;
+}
+
+/**
+ * @brief Constructs a handle and adds a reference to its entry.
+ *
+ * @tparam T The type of the stored objects.
+ * @param heap The heap owning the object.
+ * @param entry Handle table entry of the object.
+ */
+template <typename T>
+RefCountedRelocatableHeap<T>::Handle::Handle(
+    RefCountedRelocatableHeap<T> *heap, std::uint32_t entry)
+    : heap(heap), entry(entry) {
+  ++heap->entries[entry].count;
+}
+
+/**
+ * @brief Drops this handle's reference, if any.
+ *
+ * @tparam T The type of the stored objects.
+ */
+template <typename T>
+void RefCountedRelocatableHeap<T>::Handle::release_reference() {
+  if (heap != nullptr) {
+    heap->release_reference(entry);
+  }
+}
+
+/**
+ * @brief Copy constructor for sharing ownership.
+ *
+ * @tparam T The type of the stored objects.
+ * @param other The handle to share ownership with.
+ */
+template <typename T>
+RefCountedRelocatableHeap<T>::Handle::Handle(Handle &other)
+    : heap(other.heap), entry(other.entry) {
+  if (heap != nullptr) {
+    ++heap->entries[entry].count;
+  }
+}
+
+/**
+ * @brief Move constructor transferring ownership.
+ *
+ * @tparam T The type of the stored objects.
+ * @param other The handle to take ownership from; left empty.
+ */
+template <typename T>
+RefCountedRelocatableHeap<T>::Handle::Handle(Handle &&other) noexcept
+    : heap(other.heap), entry(other.entry) {
+  other.heap = nullptr;
+}
+
+/**
+ * @brief Destructor that releases the object when no references remain.
+ *
+ * @tparam T The type of the stored objects.
+ */
+template <typename T> RefCountedRelocatableHeap<T>::Handle::~Handle() {
+  release_reference();
+}
+
+/**
+ * @brief Pins the object so it can be accessed.
+ *
+ * @tparam T The type of the stored objects.
+ * @return Pin Scoped access to the object; empty if the handle is empty.
+ */
+template <typename T>
+typename RefCountedRelocatableHeap<T>::Pin
+RefCountedRelocatableHeap<T>::Handle::pin() {
+  return Pin(heap, entry);
+}
+
+/**
+ * @brief Assignment operator for sharing ownership.
+ *
+ * @tparam T The type of the stored objects.
+ * @param other The handle to assign from.
+ * @return Handle& Reference to this handle.
+ */
+template <typename T>
+typename RefCountedRelocatableHeap<T>::Handle &
+RefCountedRelocatableHeap<T>::Handle::operator=(Handle &other) {
+  if (this != &other) {
+    if (other.heap != nullptr) {
+      ++other.heap->entries[other.entry].count;
+    }
+    release_reference();
+    heap = other.heap;
+    entry = other.entry;
+  }
+  return *this;
+}
+
+/**
+ * @brief Move assignment operator transferring ownership.
+ *
+ * @tparam T The type of the stored objects.
+ * @param other The handle to take ownership from; left empty.
+ * @return Handle& Reference to this handle.
+ */
+template <typename T>
+typename RefCountedRelocatableHeap<T>::Handle &
+RefCountedRelocatableHeap<T>::Handle::operator=(Handle &&other) noexcept {
+  if (this != &other) {
+    release_reference();
+    heap = other.heap;
+    entry = other.entry;
+    other.heap = nullptr;
+  }
+  return *this;
+}
+
+/**
+ * @brief Computes the address of a global slot.
+ *
+ * @tparam T The type of the stored objects.
+ * @param slot The global slot number.
+ * @return T* Address of the slot's storage.
+ */
+template <typename T>
+T *RefCountedRelocatableHeap<T>::slot_address(std::uint32_t slot) {
+  return pages[slot / objects_per_page] + slot % objects_per_page;
+}
+
+/**
+ * @brief Allocates a new page and adds its slots to the free list.
+ *
+ * Slots are pushed in reverse so the lowest slot of the page is used first.
+ *
+ * @tparam T The type of the stored objects.
+ */
+template <typename T> void RefCountedRelocatableHeap<T>::add_page() {
+  T *page = static_cast<T *>(::operator new(objects_per_page * sizeof(T),
+                                            std::align_val_t(alignof(T))));
+  try {
+    pages.push_back(page);
+  } catch (...) {
+    ::operator delete(static_cast<void *>(page), std::align_val_t(alignof(T)));
+    throw;
+  }
+  std::uint32_t first = static_cast<std::uint32_t>(slot_owners.size());
+  slot_owners.resize(slot_owners.size() + objects_per_page, no_entry);
+  for (std::size_t offset = objects_per_page; offset > 0; --offset) {
+    free_slots.push_back(first + static_cast<std::uint32_t>(offset - 1));
+  }
+}
+
+/**
+ * @brief Removes a reference, destroying the object and freeing its slot and
+ * entry when it was the last one.
+ *
+ * @tparam T The type of the stored objects.
+ * @param entry Handle table entry of the object.
+ */
+template <typename T>
+void RefCountedRelocatableHeap<T>::release_reference(std::uint32_t entry) {
+  if (--entries[entry].count == 0) {
+    std::uint32_t slot = entries[entry].slot;
+    std::destroy_at(slot_address(slot));
+    slot_owners[slot] = no_entry;
+    free_slots.push_back(slot);
+    free_entries.push_back(entry);
+  }
+}
+
+/**
+ * @brief Constructs an empty heap.
+ *
+ * @tparam T The type of the stored objects.
+ * @param objects_per_page Number of objects stored in each page.
+ */
+template <typename T>
+RefCountedRelocatableHeap<T>::RefCountedRelocatableHeap(
+    std::size_t objects_per_page)
+    : objects_per_page(objects_per_page), pins(0) {
+  if (objects_per_page == 0) {
+    throw std::invalid_argument(
+        "RefCountedRelocatableHeap needs at least one object per page");
+  }
+}
+
+/**
+ * @brief Destroys every remaining object and frees all pages.
+ *
+ * @tparam T The type of the stored objects.
+ */
+template <typename T>
+RefCountedRelocatableHeap<T>::~RefCountedRelocatableHeap() {
+  for (std::uint32_t slot = 0; slot < slot_owners.size(); ++slot) {
+    if (slot_owners[slot] != no_entry) {
+      std::destroy_at(slot_address(slot));
+    }
+  }
+  for (T *page : pages) {
+    ::operator delete(static_cast<void *>(page), std::align_val_t(alignof(T)));
+  }
+}
+
+/**
+ * @brief Constructs a new object in a free slot.
+ *
+ * The slot and the handle table entry are taken off the free lists before
+ * the object is constructed, so a constructor that creates further objects
+ * in the same heap gets other slots, and a constructor that throws returns
+ * them. Compaction is held off while the object is being constructed.
+ *
+ * @tparam T The type of the stored objects.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param args Arguments forwarded to the T constructor.
+ * @return Handle The only owning reference to the new object.
+ */
+template <typename T>
+template <typename... Args>
+typename RefCountedRelocatableHeap<T>::Handle
+RefCountedRelocatableHeap<T>::create(Args &&...args) {
+  static_assert(std::is_nothrow_move_constructible_v<T>,
+                "relocatable objects must be nothrow move-constructible");
+  if (free_slots.empty()) {
+    add_page();
+  }
+  if (free_entries.empty()) {
+    entries.push_back(Entry{0, 0, 0});
+    try {
+      free_entries.push_back(static_cast<std::uint32_t>(entries.size() - 1));
+    } catch (...) {
+      entries.pop_back();
+      throw;
+    }
+  }
+  std::uint32_t slot = free_slots.back();
+  std::uint32_t entry = free_entries.back();
+  free_slots.pop_back();
+  free_entries.pop_back();
+  // Popping keeps the capacity, so unless a nested create grew the free
+  // lists, returning the slot and entry below cannot throw
+  ++pins;
+  try {
+    ::new (static_cast<void *>(slot_address(slot)))
+        T(std::forward<Args>(args)...);
+  } catch (...) {
+    --pins;
+    free_slots.push_back(slot);
+    free_entries.push_back(entry);
+    throw;
+  }
+  --pins;
+  entries[entry] = Entry{slot, 0, 0};
+  slot_owners[slot] = entry;
+  return Handle(this, entry);
+}
+
+/**
+ * @brief Moves live objects into dense pages and frees empty pages.
+ *
+ * Walks inwards from both ends of the heap, moving the last live object into
+ * the first free slot until the two meet, then releases every trailing page
+ * that no longer holds an object.
+ *
+ * @tparam T The type of the stored objects.
+ * @return std::size_t Number of bytes of page storage released.
+ */
+template <typename T> std::size_t RefCountedRelocatableHeap<T>::compact() {
+  if (pins != 0 || slot_owners.empty()) {
+    return 0;
+  }
+
+  std::size_t low = 0;
+  std::size_t high = slot_owners.size() - 1;
+  while (true) {
+    while (low < high && slot_owners[low] != no_entry) {
+      ++low;
+    }
+    while (low < high && slot_owners[high] == no_entry) {
+      --high;
+    }
+    if (low >= high) {
+      break;
+    }
+    T *source = slot_address(static_cast<std::uint32_t>(high));
+    ::new (static_cast<void *>(slot_address(static_cast<std::uint32_t>(low))))
+        T(std::move(*source));
+    std::destroy_at(source);
+    slot_owners[low] = slot_owners[high];
+    slot_owners[high] = no_entry;
+    entries[slot_owners[low]].slot = static_cast<std::uint32_t>(low);
+  }
+
+  std::size_t live = size();
+  std::size_t pages_needed =
+      (live + objects_per_page - 1) / objects_per_page;
+  std::size_t released = 0;
+  while (pages.size() > pages_needed) {
+    ::operator delete(static_cast<void *>(pages.back()),
+                      std::align_val_t(alignof(T)));
+    pages.pop_back();
+    released += objects_per_page * sizeof(T);
+  }
+  slot_owners.resize(pages.size() * objects_per_page);
+
+  free_slots.clear();
+  for (std::size_t slot = slot_owners.size(); slot > live; --slot) {
+    free_slots.push_back(static_cast<std::uint32_t>(slot - 1));
+  }
+  return released;
+}
+
+/**
+ * @brief Retrieves the number of live objects.
+ *
+ * @tparam T The type of the stored objects.
+ * @return std::size_t The number of live objects.
+ */
+template <typename T> std::size_t RefCountedRelocatableHeap<T>::size() {
+  return entries.size() - free_entries.size();
+}
+
+/**
+ * @brief Retrieves the number of bytes reserved for page storage.
+ *
+ * @tparam T The type of the stored objects.
+ * @return std::size_t Bytes held by all pages.
+ */
+template <typename T>
+std::size_t RefCountedRelocatableHeap<T>::get_reserved_bytes() {
+  return pages.size() * objects_per_page * sizeof(T);
+}
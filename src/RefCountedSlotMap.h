@@ -0,0 +1,192 @@
+#ifndef REFCOUNTEDSLOTMAP_HEADER
+#define REFCOUNTEDSLOTMAP_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief Table of reference-counted objects addressed by generational handles.
+ *
+ * Objects, reference counts and generation numbers are kept in separate
+ * arrays (structure-of-arrays), so handles are small index pairs and all live
+ * objects can be visited with a linear scan. Released slots go onto a free
+ * list and are reused; their generation is bumped so stale keys are detected
+ * in O(1).
+ *
+ * Two kinds of references are provided:
+ * - Handle owns a reference and keeps its object alive, like RefCountedPtr.
+ * - Key is a plain (index, generation) pair that owns nothing; it can be
+ *   stored in hot arrays and resolved or upgraded through the map.
+ *
+ * The map is not thread-safe, and pointers returned by get_data are
+ * invalidated when an insertion grows the table. Handles must not outlive
+ * their map.
+ *
+ * @tparam T The type of the stored objects.
+ */
+template <typename T> class RefCountedSlotMap {
+public:
+  /**
+   * @brief Non-owning reference to a slot at a specific generation.
+   */
+  struct Key {
+    std::uint32_t index;      ///< Slot index in the map.
+    std::uint32_t generation; ///< Generation the slot had when referenced.
+  };
+
+  /**
+   * @brief Owning reference to an object in a RefCountedSlotMap.
+   *
+   * Copies share ownership and increment the slot's reference count; the
+   * object is destroyed when the last Handle is released.
+   */
+  class Handle {
+  private:
+    RefCountedSlotMap<T> *map; ///< The map owning the slot.
+    Key key;                   ///< The referenced slot and its generation.
+
+    /**
+     * @brief Drops this handle's reference, if any.
+     */
+    void release_reference();
+
+    friend class RefCountedSlotMap<T>;
+
+    /**
+     * @brief Constructs a handle and adds a reference to its slot.
+     *
+     * @param map The map owning the slot.
+     * @param key The referenced slot and its generation.
+     */
+    Handle(RefCountedSlotMap<T> *, Key);
+
+  public:
+    /**
+     * @brief Default constructor creating an empty handle.
+     */
+    Handle() : map(nullptr), key{0, 0} {}
+
+    /**
+     * @brief Copy constructor for sharing ownership.
+     *
+     * @param other The handle to share ownership with.
+     */
+    Handle(Handle &);
+
+    /**
+     * @brief Move constructor transferring ownership.
+     *
+     * @param other The handle to take ownership from; left empty.
+     */
+    Handle(Handle &&) noexcept;
+
+    /**
+     * @brief Destructor that releases the object when no references remain.
+     */
+    ~Handle();
+
+    /**
+     * @brief Retrieves the raw pointer to the referenced object.
+     *
+     * @return T* The object, or nullptr if the handle is empty.
+     */
+    T *get_data();
+
+    /**
+     * @brief Retrieves the non-owning key of the referenced slot.
+     *
+     * @return Key The slot index and generation.
+     */
+    Key get_key();
+
+    /**
+     * @brief Assignment operator for sharing ownership.
+     *
+     * @param other The handle to assign from.
+     * @return Handle& Reference to this handle.
+     */
+    Handle &operator=(Handle &);
+
+    /**
+     * @brief Move assignment operator transferring ownership.
+     *
+     * @param other The handle to take ownership from; left empty.
+     * @return Handle& Reference to this handle.
+     */
+    Handle &operator=(Handle &&) noexcept;
+  };
+
+private:
+  std::vector<std::optional<T>> objects;  ///< Object storage per slot.
+  std::vector<std::uint32_t> counts;      ///< Reference count per slot.
+  std::vector<std::uint32_t> generations; ///< Generation per slot.
+  std::vector<std::uint32_t> free_slots;  ///< Released slots ready for reuse.
+
+  /**
+   * @brief Removes a reference, destroying the object and recycling its slot
+   * when it was the last one.
+   *
+   * @param index Index of a live slot.
+   */
+  void release_reference(std::uint32_t);
+
+public:
+  RefCountedSlotMap() = default;
+  RefCountedSlotMap(const RefCountedSlotMap<T> &) = delete;
+  RefCountedSlotMap<T> &operator=(const RefCountedSlotMap<T> &) = delete;
+
+  /**
+   * @brief Constructs a new object in a free slot.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param args Arguments to pass to the T constructor.
+   * @return Handle The only owning reference to the new object.
+   */
+  template <typename... Args> Handle insert(Args &&...);
+
+  /**
+   * @brief Checks whether a key still refers to a live object.
+   *
+   * @param key The key to check.
+   * @return bool True if the slot is live and at the key's generation.
+   */
+  bool contains(Key);
+
+  /**
+   * @brief Resolves a key to its object.
+   *
+   * @param key The key to resolve.
+   * @return T* The object, or nullptr if the key is stale.
+   */
+  T *get_data(Key);
+
+  /**
+   * @brief Upgrades a key to an owning handle.
+   *
+   * @param key The key to upgrade.
+   * @return Handle A handle to the object, or an empty handle if the key is
+   * stale.
+   */
+  Handle lock(Key);
+
+  /**
+   * @brief Retrieves the number of live objects.
+   *
+   * @return std::size_t The number of live objects.
+   */
+  std::size_t size();
+
+  /**
+   * @brief Calls a function on every live object in slot order.
+   *
+   * @tparam Function Callable taking T&.
+   * @param function The function to call.
+   */
+  template <typename Function> void for_each(Function);
+};
+
+#include "RefCountedSlotMap.tpp"
+
+#endif
@@ -0,0 +1,252 @@
+#include "RefCountedSlotMap.h"
+#include <algorithm>
+#include <utility>
+
+/**
+ * @brief Constructs a handle and adds a reference to its slot.
+ *
+ * @tparam T The type of the stored objects.
+ * @param map The map owning the slot.
+ * @param key The referenced slot and its generation.
+ */
+template <typename T>
+RefCountedSlotMap<T>::Handle::Handle(RefCountedSlotMap<T> *map, Key key)
+    : map(map), key(key) {
+  ++map->counts[key.index];
+}
+
+/**
+ * @brief Drops this handle's reference, if any.
+ *
+ * @tparam T The type of the stored objects.
+ */
+template <typename T> void RefCountedSlotMap<T>::Handle::release_reference() {
+  if (map != nullptr) {
+    map->release_reference(key.index);
+  }
+}
+
+/**
+ * @brief Copy constructor for sharing ownership.
+ *
+ * @tparam T The type of the stored objects.
+ * @param other The handle to share ownership with.
+ */
+template <typename T>
+RefCountedSlotMap<T>::Handle::Handle(Handle &other)
+    : map(other.map), key(other.key) {
+  if (map != nullptr) {
+    ++map->counts[key.index];
+  }
+}
+
+/**
+ * @brief Move constructor transferring ownership.
+ *
+ * @tparam T The type of the stored objects.
+ * @param other The handle to take ownership from; left empty.
+ */
+template <typename T>
+RefCountedSlotMap<T>::Handle::Handle(Handle &&other) noexcept
+    : map(other.map), key(other.key) {
+  other.map = nullptr;
+}
+
+/**
+ * @brief Destructor that releases the object when no references remain.
+ *
+ * @tparam T The type of the stored objects.
+ */
+template <typename T> RefCountedSlotMap<T>::Handle::~Handle() {
+  release_reference();
+}
+
+/**
+ * @brief Retrieves the raw pointer to the referenced object.
+ *
+ * @tparam T The type of the stored objects.
+ * @return T* The object, or nullptr if the handle is empty.
+ */
+template <typename T> T *RefCountedSlotMap<T>::Handle::get_data() {
+  return map != nullptr ? &*map->objects[key.index] : nullptr;
+}
+
+/**
+ * @brief Retrieves the non-owning key of the referenced slot.
+ *
+ * @tparam T The type of the stored objects.
+ * @return Key The slot index and generation.
+ */
+template <typename T>
+typename RefCountedSlotMap<T>::Key RefCountedSlotMap<T>::Handle::get_key() {
+  return key;
+}
+
+/**
+ * @brief Assignment operator for sharing ownership.
+ *
+ * @tparam T The type of the stored objects.
+ * @param other The handle to assign from.
+ * @return Handle& Reference to this handle.
+ */
+template <typename T>
+typename RefCountedSlotMap<T>::Handle &
+RefCountedSlotMap<T>::Handle::operator=(Handle &other) {
+  if (this != &other) {
+    if (other.map != nullptr) {
+      ++other.map->counts[other.key.index];
+    }
+    release_reference();
+    map = other.map;
+    key = other.key;
+  }
+  return *this;
+}
+
+/**
+ * @brief Move assignment operator transferring ownership.
+ *
+ * @tparam T The type of the stored objects.
+ * @param other The handle to take ownership from; left empty.
+ * @return Handle& Reference to this handle.
+ */
+template <typename T>
+typename RefCountedSlotMap<T>::Handle &
+RefCountedSlotMap<T>::Handle::operator=(Handle &&other) noexcept {
+  if (this != &other) {
+    release_reference();
+    map = other.map;
+    key = other.key;
+    other.map = nullptr;
+  }
+  return *this;
+}
+
+/**
+ * @brief Removes a reference, destroying the object and recycling its slot
+ * when it was the last one.
+ *
+ * Bumping the generation invalidates every outstanding Key to the slot.
+ *
+ * @tparam T The type of the stored objects.
+ * @param index Index of a live slot.
+ */
+template <typename T>
+void RefCountedSlotMap<T>::release_reference(std::uint32_t index) {
+  if (--counts[index] == 0) {
+    objects[index].reset();
+    ++generations[index];
+    free_slots.push_back(index);
+  }
+}
+
+/**
+ * @brief Constructs a new object in a free slot.
+ *
+ * Reuses a released slot when one is available, otherwise appends a new one.
+ * The slot is claimed, with all three arrays grown together, before the
+ * object is built, and the object is built outside the table and then moved
+ * in, so a constructor that inserts into the same map neither receives the
+ * same slot nor has the table reallocated underneath it. A constructor that
+ * throws returns the slot to the free list; the free list always has room
+ * for every slot, so that cannot throw.
+ *
+ * @tparam T The type of the stored objects.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param args Arguments forwarded to the T constructor.
+ * @return Handle The only owning reference to the new object.
+ */
+template <typename T>
+template <typename... Args>
+typename RefCountedSlotMap<T>::Handle
+RefCountedSlotMap<T>::insert(Args &&...args) {
+  std::uint32_t index;
+  if (!free_slots.empty()) {
+    index = free_slots.back();
+    free_slots.pop_back();
+  } else {
+    index = static_cast<std::uint32_t>(objects.size());
+    if (index == objects.capacity()) {
+      std::size_t capacity = std::max<std::size_t>(2 * index, 8);
+      objects.reserve(capacity);
+      counts.reserve(capacity);
+      generations.reserve(capacity);
+      free_slots.reserve(capacity);
+    }
+    objects.emplace_back();
+    counts.push_back(0);
+    generations.push_back(0);
+  }
+  try {
+    T object(std::forward<Args>(args)...);
+    objects[index].emplace(std::move(object));
+  } catch (...) {
+    free_slots.push_back(index);
+    throw;
+  }
+  return Handle(this, Key{index, generations[index]});
+}
+
+/**
+ * @brief Checks whether a key still refers to a live object.
+ *
+ * @tparam T The type of the stored objects.
+ * @param key The key to check.
+ * @return bool True if the slot is live and at the key's generation.
+ */
+template <typename T> bool RefCountedSlotMap<T>::contains(Key key) {
+  return key.index < generations.size() &&
+         generations[key.index] == key.generation &&
+         objects[key.index].has_value();
+}
+
+/**
+ * @brief Resolves a key to its object.
+ *
+ * @tparam T The type of the stored objects.
+ * @param key The key to resolve.
+ * @return T* The object, or nullptr if the key is stale.
+ */
+template <typename T> T *RefCountedSlotMap<T>::get_data(Key key) {
+  return contains(key) ? &*objects[key.index] : nullptr;
+}
+
+/**
+ * @brief Upgrades a key to an owning handle.
+ *
+ * @tparam T The type of the stored objects.
+ * @param key The key to upgrade.
+ * @return Handle A handle to the object, or an empty handle if the key is
+ * stale.
+ */
+template <typename T>
+typename RefCountedSlotMap<T>::Handle RefCountedSlotMap<T>::lock(Key key) {
+  return contains(key) ? Handle(this, key) : Handle();
+}
+
+/**
+ * @brief Retrieves the number of live objects.
+ *
+ * @tparam T The type of the stored objects.
+ * @return std::size_t The number of live objects.
+ */
+template <typename T> std::size_t RefCountedSlotMap<T>::size() {
+  return objects.size() - free_slots.size();
+}
+
+/**
+ * @brief Calls a function on every live object in slot order.
+ *
+ * @tparam T The type of the stored objects.
+ * @tparam Function Callable taking T&.
+ * @param function The function to call.
+ */
+template <typename T>
+template <typename Function>
+void RefCountedSlotMap<T>::for_each(Function function) {
+  for (std::optional<T> &object : objects) {
+    if (object.has_value()) {
+      function(*object);
+    }
+  }
+}
@@ -0,0 +1,259 @@
+#ifndef REFCOUNTEDVECTOR_HEADER
+#define REFCOUNTEDVECTOR_HEADER
+
+#include "RefCountedPtr.h"
+#include <cstddef>
+#include <type_traits>
+
+/**
+ * @brief Inline element storage of a RefCountedVector.
+ *
+ * @tparam T The element type.
+ * @tparam Capacity Number of elements stored inline.
+ */
+template <typename T, std::size_t Capacity> struct RefCountedInlineStorage {
+  alignas(T) unsigned char bytes[Capacity * sizeof(T)]; ///< Raw storage.
+
+  /**
+   * @brief Retrieves the first inline element slot.
+   *
+   * @return T* Start of the inline storage.
+   */
+  T *get() { return reinterpret_cast<T *>(bytes); }
+};
+
+/**
+ * @brief Empty inline storage used when a vector keeps nothing inline.
+ *
+ * @tparam T The element type.
+ */
+template <typename T> struct RefCountedInlineStorage<T, 0> {
+  /**
+   * @brief Retrieves the first inline element slot.
+   *
+   * @return T* Always nullptr.
+   */
+  T *get() { return nullptr; }
+};
+
+/**
+ * @brief Contiguous container that relocates its elements instead of copying
+ * them.
+ *
+ * Growing, inserting and erasing move elements with ref_counted_relocate, so
+ * a vector of RefCountedPtr reallocates with a single memmove and no
+ * reference count traffic, where std::vector would copy or move each element
+ * and then destroy the original. With a non-zero InlineCapacity the first
+ * elements are stored inside the vector itself (a small vector), and the heap
+ * is only used once that capacity is exceeded.
+ *
+ * @tparam T The element type; must be trivially relocatable or nothrow
+ * move-constructible.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ */
+template <typename T, std::size_t InlineCapacity = 0> class RefCountedVector {
+  static_assert(ref_counted_is_trivially_relocatable_v<T> ||
+                    std::is_nothrow_move_constructible_v<T>,
+                "elements must be relocatable without throwing");
+
+private:
+  [[no_unique_address]] RefCountedInlineStorage<T, InlineCapacity>
+      inline_storage;   ///< Storage used until InlineCapacity is exceeded.
+  T *elements;          ///< Start of the element storage.
+  std::size_t length;   ///< Number of live elements.
+  std::size_t capacity; ///< Number of elements the storage can hold.
+
+  /**
+   * @brief Checks whether the elements live in the inline storage.
+   *
+   * @return bool True if no heap storage is in use.
+   */
+  bool is_inline();
+
+  /**
+   * @brief Allocates heap storage for the given number of elements.
+   *
+   * @param capacity Number of elements.
+   * @return T* Uninitialized storage.
+   */
+  static T *allocate(std::size_t);
+
+  /**
+   * @brief Frees the heap storage, if any.
+   */
+  void deallocate();
+
+  /**
+   * @brief Computes the capacity to grow to for a required element count.
+   *
+   * @param required Minimum number of elements to hold.
+   * @return std::size_t The new capacity.
+   */
+  std::size_t grown_capacity(std::size_t);
+
+  /**
+   * @brief Switches to new storage, relocating every element into it.
+   *
+   * @param storage Uninitialized storage for at least length elements.
+   * @param capacity Number of elements the storage can hold.
+   */
+  void adopt(T *, std::size_t);
+
+public:
+  /**
+   * @brief Default constructor creating an empty vector.
+   */
+  RefCountedVector() : length(0), capacity(InlineCapacity) {
+    elements = inline_storage.get();
+  }
+
+  /**
+   * @brief Copy constructor copying every element.
+   *
+   * @param other The vector to copy.
+   */
+  RefCountedVector(RefCountedVector<T, InlineCapacity> &);
+
+  /**
+   * @brief Move constructor taking over the elements of another vector.
+   *
+   * Heap storage is taken over as is; inline elements are relocated.
+   *
+   * @param other The vector to take the elements from; left empty.
+   */
+  RefCountedVector(RefCountedVector<T, InlineCapacity> &&) noexcept;
+
+  /**
+   * @brief Destructor that destroys every element and frees the storage.
+   */
+  ~RefCountedVector();
+
+  /**
+   * @brief Retrieves the number of elements.
+   *
+   * @return std::size_t The number of elements.
+   */
+  std::size_t size();
+
+  /**
+   * @brief Retrieves the number of elements the storage can hold.
+   *
+   * @return std::size_t The capacity.
+   */
+  std::size_t get_capacity();
+
+  /**
+   * @brief Retrieves the pointer to the first element.
+   *
+   * @return T* The first element.
+   */
+  T *get_data();
+
+  /**
+   * @brief Retrieves an iterator to the first element.
+   *
+   * @return T* The first element.
+   */
+  T *begin();
+
+  /**
+   * @brief Retrieves an iterator past the last element.
+   *
+   * @return T* One past the last element.
+   */
+  T *end();
+
+  /**
+   * @brief Accesses an element without bounds checking.
+   *
+   * @param index Index of the element.
+   * @return T& Reference to the element.
+   */
+  T &operator[](std::size_t);
+
+  /**
+   * @brief Makes room for at least the given number of elements.
+   *
+   * @param capacity Number of elements to reserve space for.
+   */
+  void reserve(std::size_t);
+
+  /**
+   * @brief Constructs an element at the end.
+   *
+   * The arguments may refer to an element of this vector.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param args Arguments to pass to the T constructor.
+   * @return T& Reference to the new element.
+   */
+  template <typename... Args> T &emplace_back(Args &&...);
+
+  /**
+   * @brief Moves an element to the end.
+   *
+   * @param value The element to take over.
+   */
+  void push_back(T &&);
+
+  /**
+   * @brief Constructs an element at the given index, shifting later
+   * elements up by one.
+   *
+   * @tparam Args Variadic template for constructor arguments.
+   * @param index Index of the new element, at most size().
+   * @param args Arguments to pass to the T constructor.
+   * @return T& Reference to the new element.
+   */
+  template <typename... Args> T &emplace(std::size_t, Args &&...);
+
+  /**
+   * @brief Destroys the last element.
+   */
+  void pop_back();
+
+  /**
+   * @brief Destroys the elements in [first, last) and relocates the tail
+   * down to close the gap.
+   *
+   * @param first Index of the first element to erase.
+   * @param last Index one past the last element to erase.
+   */
+  void erase(std::size_t, std::size_t);
+
+  /**
+   * @brief Destroys the element at the given index and relocates the tail
+   * down to close the gap.
+   *
+   * @param index Index of the element to erase.
+   */
+  void erase(std::size_t);
+
+  /**
+   * @brief Destroys every element, keeping the storage.
+   */
+  void clear();
+
+  /**
+   * @brief Assignment operator copying every element.
+   *
+   * @param other The vector to copy.
+   * @return RefCountedVector<T, InlineCapacity>& Reference to this vector.
+   */
+  RefCountedVector<T, InlineCapacity> &
+  operator=(RefCountedVector<T, InlineCapacity> &);
+
+  /**
+   * @brief Move assignment operator taking over the elements of another
+   * vector.
+   *
+   * @param other The vector to take the elements from; left empty.
+   * @return RefCountedVector<T, InlineCapacity>& Reference to this vector.
+   */
+  RefCountedVector<T, InlineCapacity> &
+  operator=(RefCountedVector<T, InlineCapacity> &&) noexcept;
+};
+
+#include "RefCountedVector.tpp"
+
+#endif
@@ -0,0 +1,403 @@
+#include "RefCountedVector.h"
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <utility>
+
+/**
+ * @brief Checks whether the elements live in the inline storage.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @return bool True if no heap storage is in use.
+ */
+template <typename T, std::size_t InlineCapacity>
+bool RefCountedVector<T, InlineCapacity>::is_inline() {
+  return elements == inline_storage.get();
+}
+
+/**
+ * @brief Allocates heap storage for the given number of elements.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @param capacity Number of elements.
+ * @return T* Uninitialized storage.
+ */
+template <typename T, std::size_t InlineCapacity>
+T *RefCountedVector<T, InlineCapacity>::allocate(std::size_t capacity) {
+  return static_cast<T *>(
+      ::operator new(capacity * sizeof(T), std::align_val_t(alignof(T))));
+}
+
+/**
+ * @brief Frees the heap storage, if any.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ */
+template <typename T, std::size_t InlineCapacity>
+void RefCountedVector<T, InlineCapacity>::deallocate() {
+  if (!is_inline()) {
+    ::operator delete(static_cast<void *>(elements),
+                      std::align_val_t(alignof(T)));
+  }
+}
+
+/**
+ * @brief Computes the capacity to grow to for a required element count.
+ *
+ * Doubles the current capacity so appending stays amortized O(1).
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @param required Minimum number of elements to hold.
+ * @return std::size_t The new capacity.
+ */
+template <typename T, std::size_t InlineCapacity>
+std::size_t
+RefCountedVector<T, InlineCapacity>::grown_capacity(std::size_t required) {
+  return std::max({required, capacity * 2, std::size_t(4)});
+}
+
+/**
+ * @brief Switches to new storage, relocating every element into it.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @param storage Uninitialized storage for at least length elements.
+ * @param capacity Number of elements the storage can hold.
+ */
+template <typename T, std::size_t InlineCapacity>
+void RefCountedVector<T, InlineCapacity>::adopt(T *storage,
+                                                std::size_t capacity) {
+  ref_counted_relocate(elements, length, storage);
+  deallocate();
+  elements = storage;
+  this->capacity = capacity;
+}
+
+/**
+ * @brief Copy constructor copying every element.
+ *
+ * Elements are copied with ref_counted_copy_construct, so pairs holding a
+ * RefCountedPtr can be copied even though std::pair cannot pass a non-const
+ * reference on to its members.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @param other The vector to copy.
+ */
+template <typename T, std::size_t InlineCapacity>
+RefCountedVector<T, InlineCapacity>::RefCountedVector(
+    RefCountedVector<T, InlineCapacity> &other)
+    : RefCountedVector() {
+  reserve(other.length);
+  for (T &element : other) {
+    ref_counted_copy_construct(elements + length, element);
+    ++length;
+  }
+}
+
+/**
+ * @brief Move constructor taking over the elements of another vector.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @param other The vector to take the elements from; left empty.
+ */
+template <typename T, std::size_t InlineCapacity>
+RefCountedVector<T, InlineCapacity>::RefCountedVector(
+    RefCountedVector<T, InlineCapacity> &&other) noexcept
+    : RefCountedVector() {
+  *this = std::move(other);
+}
+
+/**
+ * @brief Destructor that destroys every element and frees the storage.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ */
+template <typename T, std::size_t InlineCapacity>
+RefCountedVector<T, InlineCapacity>::~RefCountedVector() {
+  clear();
+  deallocate();
+}
+
+/**
+ * @brief Retrieves the number of elements.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @return std::size_t The number of elements.
+ */
+template <typename T, std::size_t InlineCapacity>
+std::size_t RefCountedVector<T, InlineCapacity>::size() {
+  return length;
+}
+
+/**
+ * @brief Retrieves the number of elements the storage can hold.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @return std::size_t The capacity.
+ */
+template <typename T, std::size_t InlineCapacity>
+std::size_t RefCountedVector<T, InlineCapacity>::get_capacity() {
+  return capacity;
+}
+
+/**
+ * @brief Retrieves the pointer to the first element.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @return T* The first element.
+ */
+template <typename T, std::size_t InlineCapacity>
+T *RefCountedVector<T, InlineCapacity>::get_data() {
+  return elements;
+}
+
+/**
+ * @brief Retrieves an iterator to the first element.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @return T* The first element.
+ */
+template <typename T, std::size_t InlineCapacity>
+T *RefCountedVector<T, InlineCapacity>::begin() {
+  return elements;
+}
+
+/**
+ * @brief Retrieves an iterator past the last element.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @return T* One past the last element.
+ */
+template <typename T, std::size_t InlineCapacity>
+T *RefCountedVector<T, InlineCapacity>::end() {
+  return elements + length;
+}
+
+/**
+ * @brief Accesses an element without bounds checking.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @param index Index of the element.
+ * @return T& Reference to the element.
+ */
+template <typename T, std::size_t InlineCapacity>
+T &RefCountedVector<T, InlineCapacity>::operator[](std::size_t index) {
+  return elements[index];
+}
+
+/**
+ * @brief Makes room for at least the given number of elements.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @param capacity Number of elements to reserve space for.
+ */
+template <typename T, std::size_t InlineCapacity>
+void RefCountedVector<T, InlineCapacity>::reserve(std::size_t capacity) {
+  if (capacity > this->capacity) {
+    adopt(allocate(capacity), capacity);
+  }
+}
+
+/**
+ * @brief Constructs an element at the end.
+ *
+ * When the storage is full, the new element is constructed in the new
+ * storage before the old elements are relocated, so the arguments may refer
+ * to an element of this vector.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param args Arguments forwarded to the T constructor.
+ * @return T& Reference to the new element.
+ */
+template <typename T, std::size_t InlineCapacity>
+template <typename... Args>
+T &RefCountedVector<T, InlineCapacity>::emplace_back(Args &&...args) {
+  if (length == capacity) {
+    std::size_t grown = grown_capacity(length + 1);
+    T *storage = allocate(grown);
+    try {
+      ::new (static_cast<void *>(storage + length))
+          T(std::forward<Args>(args)...);
+    } catch (...) {
+      ::operator delete(static_cast<void *>(storage),
+                        std::align_val_t(alignof(T)));
+      throw;
+    }
+    adopt(storage, grown);
+  } else {
+    ::new (static_cast<void *>(elements + length))
+        T(std::forward<Args>(args)...);
+  }
+  return elements[length++];
+}
+
+/**
+ * @brief Moves an element to the end.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @param value The element to take over.
+ */
+template <typename T, std::size_t InlineCapacity>
+void RefCountedVector<T, InlineCapacity>::push_back(T &&value) {
+  emplace_back(std::move(value));
+}
+
+/**
+ * @brief Constructs an element at the given index, shifting later elements
+ * up by one.
+ *
+ * The element is built in scratch storage first, so a throwing constructor
+ * leaves the vector untouched, and is then relocated into the gap.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @tparam Args Variadic template for constructor arguments.
+ * @param index Index of the new element, at most size().
+ * @param args Arguments forwarded to the T constructor.
+ * @return T& Reference to the new element.
+ */
+template <typename T, std::size_t InlineCapacity>
+template <typename... Args>
+T &RefCountedVector<T, InlineCapacity>::emplace(std::size_t index,
+                                                Args &&...args) {
+  alignas(T) unsigned char scratch[sizeof(T)];
+  T *value = ::new (static_cast<void *>(scratch))
+      T(std::forward<Args>(args)...);
+  if (length == capacity) {
+    try {
+      reserve(grown_capacity(length + 1));
+    } catch (...) {
+      std::destroy_at(value);
+      throw;
+    }
+  }
+  ref_counted_relocate(elements + index, length - index,
+                       elements + index + 1);
+  ref_counted_relocate(value, 1, elements + index);
+  ++length;
+  return elements[index];
+}
+
+/**
+ * @brief Destroys the last element.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ */
+template <typename T, std::size_t InlineCapacity>
+void RefCountedVector<T, InlineCapacity>::pop_back() {
+  std::destroy_at(elements + --length);
+}
+
+/**
+ * @brief Destroys the elements in [first, last) and relocates the tail down
+ * to close the gap.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @param first Index of the first element to erase.
+ * @param last Index one past the last element to erase.
+ */
+template <typename T, std::size_t InlineCapacity>
+void RefCountedVector<T, InlineCapacity>::erase(std::size_t first,
+                                                std::size_t last) {
+  std::destroy(elements + first, elements + last);
+  ref_counted_relocate(elements + last, length - last, elements + first);
+  length -= last - first;
+}
+
+/**
+ * @brief Destroys the element at the given index and relocates the tail down
+ * to close the gap.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @param index Index of the element to erase.
+ */
+template <typename T, std::size_t InlineCapacity>
+void RefCountedVector<T, InlineCapacity>::erase(std::size_t index) {
+  erase(index, index + 1);
+}
+
+/**
+ * @brief Destroys every element, keeping the storage.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ */
+template <typename T, std::size_t InlineCapacity>
+void RefCountedVector<T, InlineCapacity>::clear() {
+  std::destroy(elements, elements + length);
+  length = 0;
+}
+
+/**
+ * @brief Assignment operator copying every element.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @param other The vector to copy.
+ * @return RefCountedVector<T, InlineCapacity>& Reference to this vector.
+ */
+template <typename T, std::size_t InlineCapacity>
+RefCountedVector<T, InlineCapacity> &
+RefCountedVector<T, InlineCapacity>::operator=(
+    RefCountedVector<T, InlineCapacity> &other) {
+  if (this != &other) {
+    RefCountedVector<T, InlineCapacity> copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+/**
+ * @brief Move assignment operator taking over the elements of another
+ * vector.
+ *
+ * Heap storage changes hands without touching the elements; inline elements
+ * are relocated.
+ *
+ * @tparam T The element type.
+ * @tparam InlineCapacity Number of elements stored without a heap allocation.
+ * @param other The vector to take the elements from; left empty.
+ * @return RefCountedVector<T, InlineCapacity>& Reference to this vector.
+ */
+template <typename T, std::size_t InlineCapacity>
+RefCountedVector<T, InlineCapacity> &
+RefCountedVector<T, InlineCapacity>::operator=(
+    RefCountedVector<T, InlineCapacity> &&other) noexcept {
+  if (this != &other) {
+    clear();
+    deallocate();
+    if (other.is_inline()) {
+      elements = inline_storage.get();
+      capacity = InlineCapacity;
+      ref_counted_relocate(other.elements, other.length, elements);
+    } else {
+      elements = other.elements;
+      capacity = other.capacity;
+      other.elements = other.inline_storage.get();
+      other.capacity = InlineCapacity;
+    }
+    length = other.length;
+    other.length = 0;
+  }
+  return *this;
+}
@@ -0,0 +1,44 @@
+#include "RefCountedPtr.h"
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief Example object printing its lifetime.
+ */
+struct Greeting {
+  std::string text; ///< The text printed by say().
+
+  /**
+   * @brief Constructs a greeting.
+   *
+   * @param text The text to print.
+   */
+  explicit Greeting(std::string text) : text(std::move(text)) {}
+
+  /**
+   * @brief Announces that the last owner is gone.
+   */
+  ~Greeting() { std::printf("released \"%s\"\n", text.c_str()); }
+
+  /**
+   * @brief Prints the greeting.
+   */
+  void say() { std::printf("%s\n", text.c_str()); }
+};
+
+/**
+ * @brief Shares one object between several pointers and releases it once the
+ * last of them goes out of scope.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  RefCountedPtr<Greeting> first(std::string("Hello from RefCountedPtr"));
+  {
+    RefCountedPtr<Greeting> second = first;
+    second.get_data()->say();
+    std::printf("owners: %zu\n", first.use_count());
+  }
+  std::printf("owners: %zu\n", first.use_count());
+  return 0;
+}
@@ -0,0 +1,43 @@
+# Compiles TrivialAbiCodegen.cpp to assembly and fails if forwarding a handle
+# or pointer by value touches memory, which means it was not passed in
+# registers.
+#
+# Expects COMPILER, SOURCE and INCLUDE to be set with -D.
+
+execute_process(
+  COMMAND ${COMPILER} -std=c++2b -O2 -S -o - -DREFCOUNTEDPTR_ENABLE_TRIVIAL_ABI
+          -I${INCLUDE} ${SOURCE}
+  OUTPUT_VARIABLE assembly
+  ERROR_VARIABLE errors
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "Compiling ${SOURCE} failed:\n${errors}")
+endif()
+
+string(REPLACE ";" "" assembly "${assembly}")
+string(REPLACE "\n" ";" lines "${assembly}")
+
+foreach(function forward_handle forward_pointer)
+  set(inside FALSE)
+  set(found FALSE)
+  foreach(line IN LISTS lines)
+    if(line MATCHES "^_?${function}:")
+      set(inside TRUE)
+      set(found TRUE)
+    elseif(inside)
+      string(STRIP "${line}" instruction)
+      if(instruction MATCHES "^ret")
+        break()
+      endif()
+      # Directives and labels are not instructions
+      if(NOT instruction MATCHES "^[.#]" AND NOT instruction MATCHES ":$"
+         AND instruction MATCHES "[[(]")
+        message(FATAL_ERROR
+                "${function} accesses memory: '${instruction}'\n${assembly}")
+      endif()
+    endif()
+  endforeach()
+  if(NOT found)
+    message(FATAL_ERROR "${function} not found in the assembly")
+  endif()
+endforeach()
@@ -0,0 +1,124 @@
+#include "CompactRefCountedPtr.h"
+#include "TestSupport.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Graph node stored in an arena.
+ */
+struct Node {
+  int id;           ///< Payload.
+  std::string name; ///< Payload owning heap memory.
+
+  /**
+   * @brief Constructs a node.
+   *
+   * @param id The payload.
+   */
+  Node(int id) : id(id), name(std::to_string(id)) {}
+};
+
+static RefCountedArena<Node> small_arena(4);
+
+/**
+ * @brief Compact pointers are four bytes and share like RefCountedPtr.
+ */
+static void test_sharing() {
+  static_assert(sizeof(CompactRefCountedPtr<Node>) == 4);
+  CompactRefCountedPtr<Node> first(1);
+  CompactRefCountedPtr<Node> second(first);
+  CompactRefCountedPtr<Node> third;
+  third = second;
+  CHECK(third.get_data()->id == 1);
+  CompactRefCountedPtr<Node> moved(std::move(third));
+  CHECK(third.get_data() == nullptr && moved.get_data() == first.get_data());
+  std::vector<CompactRefCountedPtr<Node>> nodes;
+  for (int id = 0; id < 100; ++id) {
+    nodes.emplace_back(id);
+  }
+  CHECK(nodes[50].get_data()->name == "50");
+}
+
+/**
+ * @brief A full arena throws, and released slots are reused.
+ */
+static void test_capacity() {
+  std::vector<CompactRefCountedPtr<Node, small_arena>> nodes;
+  for (int id = 0; id < 4; ++id) {
+    nodes.emplace_back(id);
+  }
+  bool threw = false;
+  try {
+    CompactRefCountedPtr<Node, small_arena> extra(9);
+  } catch (std::bad_alloc &) {
+    threw = true;
+  }
+  CHECK(threw);
+  nodes.pop_back();
+  CompactRefCountedPtr<Node, small_arena> reused(7);
+  CHECK(reused.get_data()->id == 7);
+}
+
+/**
+ * @brief Slots are laid out contiguously and never move as the arena
+ * commits more memory, and destroying the arena destroys the objects that are
+ * still alive.
+ */
+static void test_contiguity_and_teardown() {
+  {
+    RefCountedArena<Tracked> arena(50000);
+    std::vector<std::uint32_t> indices;
+    indices.push_back(arena.create(0));
+    arena.add_reference(indices.back());
+    Tracked *first = arena.get_data(indices[0]);
+    for (int value = 1; value < 30000; ++value) {
+      indices.push_back(arena.create(value));
+      arena.add_reference(indices.back());
+    }
+    CHECK(Tracked::live == 30000);
+    CHECK(arena.get_data(indices[0]) == first && first->value == 0);
+    CHECK(reinterpret_cast<unsigned char *>(arena.get_data(indices[29999])) -
+              reinterpret_cast<unsigned char *>(first) ==
+          29999 * static_cast<std::ptrdiff_t>(arena.get_slot_size()));
+    CHECK(arena.get_data(indices[29999])->value == 29999);
+    arena.release_reference(indices[1500]);
+    CHECK(Tracked::live == 29999);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Concurrent creation, copies and releases keep the arena consistent.
+ */
+static void test_concurrency() {
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < 4; ++thread) {
+    threads.emplace_back([] {
+      for (int round = 0; round < 1000; ++round) {
+        CompactRefCountedPtr<Node> node(round);
+        CompactRefCountedPtr<Node> copy(node);
+        CHECK(copy.get_data()->id == round);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+/**
+ * @brief Runs the compact pointer tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_sharing();
+  test_capacity();
+  test_contiguity_and_teardown();
+  test_concurrency();
+  return 0;
+}
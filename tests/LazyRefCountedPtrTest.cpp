@@ -0,0 +1,101 @@
+#include "LazyRefCountedPtr.h"
+#include "TestSupport.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Object that is slow to build and counts how often it was built.
+ */
+struct Expensive {
+  static inline std::atomic<int> built{0}; ///< Constructions so far.
+  int value;                               ///< Payload.
+
+  /**
+   * @brief Builds the object slowly.
+   */
+  Expensive() : value(42) {
+    ++built;
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+};
+
+static int failures_left = 1; ///< Calls the flaky factory still fails.
+
+constinit LazyRefCountedPtr<Expensive>
+    global([] { return RefCountedPtr<Expensive>(new Expensive); });
+LazyRefCountedPtr<int> flaky([] {
+  if (failures_left-- > 0) {
+    throw std::runtime_error("not yet");
+  }
+  return RefCountedPtr<int>(7);
+});
+LazyRefCountedPtr<int> empty([] { return RefCountedPtr<int>(); });
+
+/**
+ * @brief Concurrent first use runs the factory exactly once.
+ */
+static void test_single_initialization() {
+  CHECK(!global.is_initialized() && Expensive::built == 0);
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < 8; ++thread) {
+    threads.emplace_back([] {
+      for (int round = 0; round < 100; ++round) {
+        RefCountedPtr<Expensive> pointer = global.get_ptr();
+        CHECK(pointer.get_data()->value == 42);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  CHECK(Expensive::built == 1 && global.is_initialized());
+  RefCountedPtr<Expensive> kept = global.get_ptr();
+  CHECK(kept.use_count() == 2 && global.get_data() == kept.get_data());
+}
+
+/**
+ * @brief A throwing factory is retried, and an empty result is kept.
+ */
+static void test_failure_and_empty() {
+  bool threw = false;
+  try {
+    flaky.get_data();
+  } catch (std::runtime_error &) {
+    threw = true;
+  }
+  CHECK(threw && !flaky.is_initialized() && *flaky.get_data() == 7);
+  CHECK(empty.get_data() == nullptr && empty.get_ptr().get_data() == nullptr);
+}
+
+/**
+ * @brief Any callable can be the factory, and the lazy pointer has no
+ * destructor that could release the object at exit.
+ */
+static void test_generic_factory() {
+  static_assert(std::is_trivially_destructible_v<LazyRefCountedPtr<int>>);
+  int seed = 21;
+  static auto doubled = make_lazy_ref_counted<Tracked>(
+      [seed] { return RefCountedPtr<Tracked>(seed * 2); });
+  CHECK(doubled.get_data()->value == 42);
+  static LazyRefCountedPtr<int, RefCountedDefaultCounter,
+                           std::function<RefCountedPtr<int>()>>
+      wrapped([] { return RefCountedPtr<int>(3); });
+  CHECK(*wrapped.get_ptr().get_data() == 3);
+}
+
+/**
+ * @brief Runs the lazy global tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_single_initialization();
+  test_failure_and_empty();
+  test_generic_factory();
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include "RefCountedAny.h"
+#include "TestSupport.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief Plugin object stored without a common base class.
+ */
+struct Plugin : Tracked {
+  std::string name; ///< Payload.
+
+  /**
+   * @brief Constructs a plugin.
+   *
+   * @param name The payload.
+   */
+  Plugin(std::string name) : name(std::move(name)) {}
+};
+
+/**
+ * @brief Objects of unrelated types are stored and checked by type.
+ */
+static void test_registry() {
+  {
+    std::vector<RefCountedAny<>> registry;
+    registry.push_back(make_ref_counted_any<Plugin>("audio"));
+    registry.push_back(make_ref_counted_any<int>(7));
+    RefCountedPtr<std::string> text(new std::string("x"));
+    registry.emplace_back(text);
+    RefCountedPtr<double> lazy(ref_counted_lazy, new double(1.5));
+    registry.emplace_back(std::move(lazy));
+    CHECK(registry[0].has_type<Plugin>() && !registry[0].has_type<int>());
+    CHECK(registry[0].get_data<Plugin>()->name == "audio");
+    CHECK(registry[0].get_data<int>() == nullptr);
+    CHECK(*registry[1].get_data<int>() == 7);
+    CHECK(*registry[3].get_data<double>() == 1.5);
+    CHECK(text.use_count() == 2);
+    RefCountedPtr<Plugin> plugin = registry[0].get_ptr<Plugin>();
+    CHECK(plugin.use_count() == 2);
+    CHECK(registry[0].get_ptr<int>().get_data() == nullptr);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Copies share the object and moves leave the source empty.
+ */
+static void test_copy_and_move() {
+  RefCountedAny<> original = make_ref_counted_any<Plugin>("video");
+  RefCountedAny<> copy = original;
+  RefCountedAny<> moved = std::move(copy);
+  CHECK(!copy.has_value() && moved.has_value());
+  copy = moved;
+  moved = RefCountedAny<>();
+  CHECK(!moved.has_value());
+  CHECK(copy.get_data<Plugin>() == original.get_data<Plugin>());
+  RefCountedPtr<int> none;
+  RefCountedAny<> empty(none);
+  CHECK(!empty.has_value() && !empty.has_type<int>());
+}
+
+/**
+ * @brief Pointers to const objects are stored and only found as const.
+ */
+static void test_const() {
+  {
+    RefCountedPtr<const Plugin> shared(std::string("midi"));
+    RefCountedAny<> copied(shared);
+    CHECK(shared.use_count() == 2);
+    CHECK(copied.has_type<const Plugin>() && !copied.has_type<Plugin>());
+    CHECK(copied.get_data<Plugin>() == nullptr);
+    CHECK(copied.get_data<const Plugin>()->name == "midi");
+    RefCountedPtr<const Plugin> typed = copied.get_ptr<const Plugin>();
+    CHECK(typed.get_data() == shared.get_data());
+    const int *raw = new int(3);
+    RefCountedPtr<const int> lazy(ref_counted_lazy, raw);
+    RefCountedAny<> moved(std::move(lazy));
+    CHECK(lazy.get_data() == nullptr);
+    CHECK(*moved.get_data<const int>() == 3);
+    CHECK(!moved.has_type<int>() && !moved.has_type<const long>());
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Runs the type-erased pointer tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_registry();
+  test_copy_and_move();
+  test_const();
+  CHECK(Tracked::live == 0);
+  return 0;
+}
@@ -0,0 +1,128 @@
+#include "RefCountedPtr.h"
+#include "TestSupport.h"
+#include <cstdint>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Element whose constructor throws once a given number of instances
+ * exist.
+ */
+struct Fragile : Tracked {
+  static inline int limit = 1000; ///< Instance count that makes it throw.
+
+  /**
+   * @brief Constructs an element, throwing at the limit.
+   */
+  Fragile() {
+    if (live > limit) {
+      throw 1;
+    }
+  }
+};
+
+/**
+ * @brief Elements are aligned, initialized and shared with the array.
+ */
+static void test_elements() {
+  RefCountedPtr<float[]> floats = make_ref_counted_array<float, 64>(100);
+  CHECK(reinterpret_cast<std::uintptr_t>(floats.get_data()) % 64 == 0);
+  CHECK(floats.get_length() == 100 && floats[5] == 0.0f);
+  floats[5] = 2.0f;
+  RefCountedPtr<float[]> copy(floats);
+  float sum = 0.0f;
+  for (float element : copy.get_span()) {
+    sum += element;
+  }
+  CHECK(sum == 2.0f && floats.use_count() == 2 && !floats.is_unique());
+  RefCountedPtr<int[]> filled = make_ref_counted_array<int>(3, 7);
+  CHECK(filled[2] == 7 && filled.is_unique());
+  RefCountedPtr<int[]> empty;
+  CHECK(empty.get_length() == 0 && empty.get_span().empty());
+  RefCountedPtr<int[]> zero = make_ref_counted_array<int, 4096>(0);
+  CHECK(zero.get_span().empty());
+}
+
+/**
+ * @brief A throwing element constructor destroys the built elements.
+ */
+static void test_throwing_element() {
+  Fragile::limit = 3;
+  bool threw = false;
+  try {
+    make_ref_counted_array<Fragile>(10);
+  } catch (int) {
+    threw = true;
+  }
+  CHECK(threw && Tracked::live == 0);
+  Fragile::limit = 1000;
+  {
+    RefCountedPtr<Fragile[]> elements = make_ref_counted_array<Fragile>(2);
+    CHECK(Tracked::live == 2);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Aliasing pointers into an array keep the whole array alive.
+ */
+static void test_element_alias() {
+  RefCountedPtr<std::string> element;
+  {
+    RefCountedPtr<std::string[]> strings =
+        make_ref_counted_array<std::string>(4, std::string("x"));
+    element = RefCountedPtr<std::string>(strings, &strings[3]);
+    CHECK(strings.use_count() == 2);
+  }
+  CHECK(*element.get_data() == "x" && element.use_count() == 1);
+}
+
+/**
+ * @brief Oversized lengths throw instead of wrapping the allocation size.
+ */
+static void test_overflow() {
+  bool threw = false;
+  try {
+    make_ref_counted_array<std::uint64_t>(SIZE_MAX / 4);
+  } catch (std::bad_array_new_length &) {
+    threw = true;
+  }
+  CHECK(threw);
+}
+
+/**
+ * @brief Moves transfer the array without touching the count, so arrays
+ * can be reassigned from temporaries and stored in standard containers.
+ */
+static void test_move() {
+  {
+    RefCountedPtr<Tracked[]> first = make_ref_counted_array<Tracked>(3);
+    RefCountedPtr<Tracked[]> second(std::move(first));
+    CHECK(first.get_data() == nullptr && second.use_count() == 1);
+    second = RefCountedPtr<Tracked[]>();
+    CHECK(second.get_data() == nullptr && Tracked::live == 0);
+    std::vector<RefCountedPtr<Tracked[]>> arrays;
+    for (int index = 0; index < 10; ++index) {
+      arrays.push_back(make_ref_counted_array<Tracked>(2, Tracked(index)));
+    }
+    CHECK(arrays[9][1].value == 9 && arrays[0].use_count() == 1);
+    CHECK(Tracked::live == 20);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Runs the shared array tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_elements();
+  test_throwing_element();
+  test_element_alias();
+  test_overflow();
+  test_move();
+  return 0;
+}
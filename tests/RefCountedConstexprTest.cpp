@@ -0,0 +1,163 @@
+#include "RefCountedPtr.h"
+#include "TestSupport.h"
+#include <string_view>
+
+/**
+ * @brief Configuration object built at compile time.
+ */
+struct Config {
+  int level;             ///< Payload.
+  std::string_view name; ///< Payload.
+
+  /**
+   * @brief Constructs a configuration.
+   *
+   * @param level The level.
+   * @param name The name.
+   */
+  constexpr Config(int level, std::string_view name)
+      : level(level), name(name) {}
+};
+
+/**
+ * @brief Static object that can hand out pointers to itself.
+ */
+struct StaticNode : EnableRefCountedFromThis<StaticNode> {
+  int value; ///< Payload.
+
+  /**
+   * @brief Constructs a node.
+   *
+   * @param value The payload.
+   */
+  constexpr StaticNode(int value) : value(value) {}
+};
+
+/**
+ * @brief Tree node sharing subtrees, built during constant evaluation.
+ */
+struct TreeNode {
+  int value;                        ///< Payload.
+  RefCountedPtr<TreeNode> left;     ///< Left subtree.
+  RefCountedPtr<TreeNode> right;    ///< Right subtree.
+
+  /**
+   * @brief Constructs a leaf.
+   *
+   * @param value The payload.
+   */
+  constexpr TreeNode(int value) : value(value) {}
+
+  /**
+   * @brief Constructs an inner node sharing both subtrees.
+   *
+   * @param value The payload.
+   * @param left The left subtree.
+   * @param right The right subtree.
+   */
+  constexpr TreeNode(int value, RefCountedPtr<TreeNode> &left,
+                     RefCountedPtr<TreeNode> &right)
+      : value(value), left(left), right(right) {}
+};
+
+constinit RefCountedStaticBlock<Config> default_config_block(3, "default");
+constinit RefCountedPtr<Config> default_config(default_config_block);
+constinit RefCountedPtr<Config> no_config;
+constinit RefCountedPtr<Config> null_config(nullptr);
+constinit RefCountedPtr<int[]> no_array(nullptr);
+constinit RefCountedHandle<int> no_handle;
+constinit RefCountedUniquePtr<int> no_unique;
+constinit RefCountedRef<int> no_borrow;
+constinit RefCountedStaticBlock<StaticNode> node_block(9);
+
+/**
+ * @brief Sums a tree, counting shared subtrees once per path.
+ *
+ * @param node The root.
+ * @return int The sum of every value reached.
+ */
+constexpr int sum(RefCountedPtr<TreeNode> &node) {
+  if (node.get_data() == nullptr) {
+    return 0;
+  }
+  return node.get_data()->value + sum(node.get_data()->left) +
+         sum(node.get_data()->right);
+}
+
+/**
+ * @brief Builds, shares and releases a tree during constant evaluation.
+ *
+ * @return int The sums of the trees built.
+ */
+constexpr int build_tree() {
+  RefCountedPtr<TreeNode> leaf(1);
+  RefCountedPtr<TreeNode> shared(new TreeNode(2));
+  RefCountedPtr<TreeNode> first(3, leaf, shared);
+  RefCountedPtr<TreeNode> second(4, shared, shared);
+  RefCountedPtr<TreeNode> copy = second;
+  copy = first;
+  RefCountedPtr<TreeNode> moved = std::move(copy);
+  moved = RefCountedPtr<TreeNode>(nullptr);
+  RefCountedPtr<TreeNode> isolated(ref_counted_isolated, 7);
+  return sum(first) + sum(second) + isolated.get_data()->value;
+}
+
+static_assert(build_tree() == 6 + 8 + 7);
+
+/**
+ * @brief constinit globals wrap the static block and empty pointers.
+ */
+static void test_constinit_globals() {
+  CHECK(default_config.get_data()->level == 3);
+  CHECK(no_config.get_data() == nullptr && null_config.get_data() == nullptr);
+  CHECK(no_array.get_length() == 0 && no_handle.get_data() == nullptr);
+  CHECK(no_unique.get_data() == nullptr && no_borrow.get_data() == nullptr);
+  RefCountedPtr<Config> copy = default_config;
+  CHECK(!copy.is_unique());
+  Config *clone = copy.make_mutable();
+  CHECK(clone != default_config.get_data() && clone->level == 3);
+  RefCountedPtr<Config> again(default_config_block);
+  CHECK(again.get_data() == default_config.get_data());
+}
+
+/**
+ * @brief Static blocks link objects that hand out pointers to themselves.
+ */
+static void test_static_self_link() {
+  RefCountedPtr<StaticNode> node(node_block);
+  RefCountedPtr<StaticNode> self = node.get_data()->ref_from_this();
+  CHECK(self.get_data() == node.get_data() && self.get_data()->value == 9);
+}
+
+/**
+ * @brief The constexpr code paths work at run time as well.
+ */
+static void test_runtime_tree() {
+  CHECK(build_tree() == 21);
+}
+
+/**
+ * @brief A static block never destroys its object, even when the block
+ * itself goes away.
+ */
+static void test_static_block_is_immortal() {
+  {
+    RefCountedStaticBlock<Tracked> block(7);
+    RefCountedPtr<Tracked> pointer(block);
+    CHECK(pointer.get_data()->value == 7 && Tracked::live == 1);
+  }
+  CHECK(Tracked::live == 1);
+}
+
+/**
+ * @brief Runs the constant initialization tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_constinit_globals();
+  test_static_self_link();
+  test_runtime_tree();
+  test_static_block_is_immortal();
+  return 0;
+}
@@ -0,0 +1,101 @@
+#include "RefCountedCowMap.h"
+#include "RefCountedCowVector.h"
+#include "TestSupport.h"
+#include <string>
+
+/**
+ * @brief Copies share elements until one of them is modified.
+ */
+static void test_cow_vector() {
+  RefCountedCowVector<std::string> first;
+  CHECK(first.size() == 0 && first.begin() == first.end());
+  first.emplace_back("x");
+  first.emplace_back("y");
+  RefCountedCowVector<std::string> second = first;
+  CHECK(first.is_shared() && &first[0] == &second[0]);
+  second.get_mutable(0) = "w";
+  CHECK(first[0] == "x" && second[0] == "w" && !first.is_shared());
+  const std::string *before = &first[0];
+  first.get_mutable(0) = "q";
+  CHECK(&first[0] == before);
+  RefCountedCowVector<std::string> cleared = first;
+  cleared.clear();
+  CHECK(cleared.size() == 0 && first.size() == 2);
+  first.erase(0);
+  first.pop_back();
+  CHECK(first.size() == 0);
+}
+
+/**
+ * @brief Lookups never copy; modifications copy only while shared.
+ */
+static void test_cow_map() {
+  RefCountedCowMap<int, std::string> first;
+  first.emplace(2, "two");
+  first.emplace(1, "one");
+  RefCountedCowMap<int, std::string> second = first;
+  CHECK(second.find_mutable(5) == nullptr && first.is_shared());
+  CHECK(!second.erase(5) && first.is_shared());
+  *second.find_mutable(1) = "uno";
+  CHECK(*first.find(1) == "one" && *second.find(1) == "uno");
+  CHECK(second.erase(2) && first.contains(2) && second.size() == 1);
+  int count = 0;
+  for (const std::pair<int, std::string> &entry : first) {
+    CHECK(entry.first == count + 1);
+    ++count;
+  }
+  CHECK(count == 2);
+  second = first;
+  second.clear();
+  CHECK(first.size() == 2);
+}
+
+/**
+ * @brief Copy-on-write maps of RefCountedPtr values clone their entries on
+ * the first write after a copy.
+ */
+static void test_cow_map_of_pointers() {
+  RefCountedCowMap<int, RefCountedPtr<std::string>> first;
+  first.emplace(1, "one");
+  RefCountedCowMap<int, RefCountedPtr<std::string>> second = first;
+  second.emplace(2, "two");
+  CHECK(first.size() == 1 && second.size() == 2 && !first.is_shared());
+  CHECK(first.find_mutable(1)->get_data() ==
+        second.find_mutable(1)->get_data());
+  CHECK(first.find_mutable(1)->use_count() == 2);
+}
+
+/**
+ * @brief make_mutable clones once for a whole batch of modifications.
+ */
+static void test_batch_mutation() {
+  RefCountedCowVector<int> first;
+  for (int value = 0; value < 4; ++value) {
+    first.emplace_back(value);
+  }
+  RefCountedCowVector<int> second = first;
+  RefCountedVector<int> &elements = second.make_mutable();
+  for (int &element : elements) {
+    element *= 10;
+  }
+  CHECK(first[3] == 3 && second[3] == 30 && !first.is_shared());
+  CHECK(&second.make_mutable() == &elements);
+  RefCountedCowMap<int, std::string> map;
+  map.emplace(1, "one");
+  RefCountedCowMap<int, std::string> copy = map;
+  copy.make_mutable().emplace(2, "two");
+  CHECK(map.size() == 1 && copy.size() == 2);
+}
+
+/**
+ * @brief Runs the copy-on-write container tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_cow_vector();
+  test_cow_map();
+  test_cow_map_of_pointers();
+  test_batch_mutation();
+  return 0;
+}
@@ -0,0 +1,52 @@
+#include "RefCountedFlatMap.h"
+#include "TestSupport.h"
+#include <string>
+
+/**
+ * @brief Entries stay sorted and lookups find them.
+ */
+static void test_sorted_entries() {
+  RefCountedFlatMap<int, RefCountedPtr<std::string>> map;
+  for (int key = 100; key > 0; --key) {
+    map.emplace(key, std::to_string(key));
+  }
+  CHECK(map.size() == 100 && *map.find(42)->get_data() == "42");
+  CHECK(!map.emplace(42, "no").second);
+  CHECK(map.erase(42) && !map.contains(42) && !map.erase(42));
+  int previous = 0;
+  for (std::pair<int, RefCountedPtr<std::string>> &entry : map) {
+    CHECK(entry.first > previous);
+    previous = entry.first;
+  }
+  map[1000];
+  CHECK(map.find(1000)->get_data() == nullptr);
+  map.clear();
+  CHECK(map.size() == 0);
+}
+
+/**
+ * @brief Maps of RefCountedPtr values can be copied, and the copies share
+ * the values.
+ */
+static void test_copy_pointer_values() {
+  RefCountedFlatMap<int, RefCountedPtr<std::string>> map;
+  map.emplace(1, "one");
+  map.emplace(2, "two");
+  RefCountedFlatMap<int, RefCountedPtr<std::string>> copy(map);
+  CHECK(copy.size() == 2 &&
+        copy.find(2)->get_data() == map.find(2)->get_data());
+  CHECK(map.find(1)->use_count() == 2);
+  copy.erase(1);
+  CHECK(map.find(1)->use_count() == 1);
+}
+
+/**
+ * @brief Runs the flat map tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_sorted_entries();
+  test_copy_pointer_values();
+  return 0;
+}
@@ -0,0 +1,132 @@
+#include "RefCountedPtr.h"
+#include "TestSupport.h"
+#include <cstdlib>
+#include <new>
+
+static int allocations = 0; ///< Calls to the global operator new.
+
+/**
+ * @brief Counts every allocation made through the global operator new.
+ *
+ * @param size Number of bytes.
+ * @return void* The allocation.
+ */
+void *operator new(std::size_t size) {
+  ++allocations;
+  if (void *memory = std::malloc(size == 0 ? 1 : size)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+/**
+ * @brief Frees memory from the counting operator new.
+ *
+ * @param memory The allocation.
+ */
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+/**
+ * @brief Frees memory from the counting operator new.
+ *
+ * @param memory The allocation.
+ * @param size Number of bytes.
+ */
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+
+/**
+ * @brief Message built in a ring slot.
+ */
+struct Message : EnableRefCountedFromThis<Message>, Tracked {
+  int extra; ///< Second payload.
+
+  /**
+   * @brief Constructs a message.
+   *
+   * @param value The first payload.
+   * @param extra The second payload.
+   */
+  Message(int value, int extra) : Tracked(value), extra(extra) {}
+};
+
+/**
+ * @brief Type whose constructor always throws.
+ */
+struct Thrower {
+  /**
+   * @brief Throws.
+   */
+  Thrower() { throw 1; }
+};
+
+/**
+ * @brief Preallocated slots.
+ */
+struct Ring {
+  alignas(64) unsigned char slots[4][128]; ///< Storage for the objects.
+};
+
+/**
+ * @brief Objects live in the caller's storage and hand it back on release.
+ */
+static void test_release_returns_storage() {
+  static_assert(ref_counted_placement_size<Message> <= sizeof(Ring::slots[0]));
+  Ring ring;
+  void *returned = nullptr;
+  int before = allocations;
+  {
+    RefCountedPtr<Message> message = make_ref_counted_in<Message>(
+        ring.slots[1], sizeof(ring.slots[1]),
+        [&returned](void *storage) { returned = storage; }, 3, 4);
+    RefCountedPtr<Message> copy = message;
+    RefCountedPtr<Message> self = message.get_data()->ref_from_this();
+    CHECK(self.use_count() == 3 && copy.get_data()->extra == 4);
+  }
+  CHECK(allocations == before && returned == ring.slots[1]);
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Storage that is too small or misaligned is rejected, and a throwing
+ * constructor leaves the storage with the caller.
+ */
+static void test_rejected_storage() {
+  Ring ring;
+  bool threw = false;
+  try {
+    make_ref_counted_in<Message>(ring.slots[0] + 1, 100, [](void *) {}, 1, 2);
+  } catch (std::bad_alloc &) {
+    threw = true;
+  }
+  CHECK(threw);
+  threw = false;
+  try {
+    make_ref_counted_in<Message>(ring.slots[0], 4, [](void *) {}, 1, 2);
+  } catch (std::bad_alloc &) {
+    threw = true;
+  }
+  CHECK(threw);
+  bool released = false;
+  try {
+    make_ref_counted_in<Thrower>(ring.slots[2], sizeof(ring.slots[2]),
+                                 [&released](void *) { released = true; });
+  } catch (int) {
+  }
+  CHECK(!released);
+  void (*release)(void *) = [](void *) {};
+  RefCountedPtr<int> number =
+      make_ref_counted_in<int>(ring.slots[3], sizeof(ring.slots[3]), release,
+                               9);
+  CHECK(*number.get_data() == 9);
+}
+
+/**
+ * @brief Runs the caller-provided storage tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_release_returns_storage();
+  test_rejected_storage();
+  return 0;
+}
@@ -0,0 +1,408 @@
+#include "RefCountedPtr.h"
+#include "TestSupport.h"
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+
+/**
+ * @brief Type whose hot fields are kept off the counter's cache line.
+ */
+struct Hot {
+  long fields[2]; ///< Hot fields.
+};
+
+template <> struct ref_counted_isolate_counter<Hot> : std::true_type {};
+
+/**
+ * @brief Over-aligned type.
+ */
+struct alignas(256) Wide {
+  int value = 4; ///< Payload.
+};
+
+/**
+ * @brief First base of Derived.
+ */
+struct Left {
+  int left = 1;            ///< Payload.
+  virtual ~Left() = default;
+};
+
+/**
+ * @brief Second base of Derived, at a non-zero offset.
+ */
+struct Right {
+  int right = 2;            ///< Payload.
+  virtual ~Right() = default;
+};
+
+/**
+ * @brief Type with two polymorphic bases.
+ */
+struct Derived : Left, Right {
+  int derived = 3; ///< Payload.
+};
+
+/**
+ * @brief Polymorphic base that clones through ref_counted_clone.
+ */
+struct Shape {
+  virtual ~Shape() = default;
+
+  /**
+   * @brief Copies the object with its dynamic type.
+   *
+   * @return RefCountedPtr<Shape> The copy.
+   */
+  virtual RefCountedPtr<Shape> ref_counted_clone() = 0;
+
+  /**
+   * @brief Retrieves the number of corners.
+   *
+   * @return int The number of corners.
+   */
+  virtual int get_corners() = 0;
+};
+
+/**
+ * @brief Shape whose copies must not be sliced.
+ */
+struct Square : Shape {
+  RefCountedPtr<Shape> ref_counted_clone() override {
+    return RefCountedPtr<Square>(*this);
+  }
+
+  int get_corners() override { return 4; }
+};
+
+/**
+ * @brief Object that can hand out pointers to itself.
+ */
+struct Self : EnableRefCountedFromThis<Self>, Tracked {
+  using Tracked::Tracked;
+};
+
+/**
+ * @brief Checks whether a pointer is aligned to the given boundary.
+ *
+ * @param pointer The address.
+ * @param alignment The boundary.
+ * @return bool True if pointer is a multiple of alignment.
+ */
+static bool is_aligned(const void *pointer, std::size_t alignment) {
+  return reinterpret_cast<std::uintptr_t>(pointer) % alignment == 0;
+}
+
+/**
+ * @brief Copies, assignments and moves share one object and release it once.
+ */
+static void test_shared_ownership() {
+  {
+    RefCountedPtr<Tracked> a(5);
+    RefCountedPtr<Tracked> b(a);
+    RefCountedPtr<Tracked> c;
+    c = b;
+    CHECK(c.get_data() == a.get_data() && c.get_data()->value == 5);
+    CHECK(a.use_count() == 3);
+    RefCountedPtr<Tracked> d(std::move(c));
+    CHECK(c.get_data() == nullptr && a.use_count() == 3);
+    d = RefCountedPtr<Tracked>(new Tracked(6));
+    CHECK(a.use_count() == 2 && Tracked::live == 2);
+  }
+  CHECK(Tracked::live == 0);
+  RefCountedPtr<Tracked> empty;
+  RefCountedPtr<Tracked> copy(empty);
+  CHECK(copy.get_data() == nullptr && copy.use_count() == 0);
+}
+
+/**
+ * @brief Custom deleters run once and stateless ones add no storage.
+ */
+static void test_custom_deleter() {
+  static int freed = 0;
+  auto deleter = [](int *pointer) {
+    ++freed;
+    std::free(pointer);
+  };
+  static_assert(sizeof(RefCountedPointerBlock<int, decltype(deleter)>) ==
+                sizeof(RefCountedPointerBlock<int, std::default_delete<int>>));
+  {
+    int *memory = static_cast<int *>(std::malloc(sizeof(int)));
+    RefCountedPtr<int> a(memory, deleter);
+    RefCountedPtr<int> b(a);
+  }
+  CHECK(freed == 1);
+}
+
+/**
+ * @brief Every construction path honors the alignment of the object.
+ */
+static void test_alignment() {
+  RefCountedPtr<Wide> fused(Wide{});
+  RefCountedPtr<Wide> raw(new Wide);
+  RefCountedPtr<Hot> hot(Hot{});
+  CHECK(is_aligned(fused.get_data(), 256) && fused.get_data()->value == 4);
+  CHECK(is_aligned(raw.get_data(), 256));
+  CHECK(is_aligned(hot.get_data(), ref_counted_cache_line_size));
+  static_assert(sizeof(RefCountedInplaceBlock<Hot>) ==
+                2 * ref_counted_cache_line_size);
+}
+
+/**
+ * @brief Isolated blocks fill whole cache lines; packed blocks do not.
+ */
+static void test_layouts() {
+  using Isolated = RefCountedInplaceBlock<int, RefCountedLayout::Isolated>;
+  static_assert(alignof(Isolated) == ref_counted_cache_line_size);
+  static_assert(sizeof(Isolated) == ref_counted_cache_line_size);
+  static_assert(sizeof(RefCountedInplaceBlock<int>) <
+                ref_counted_cache_line_size);
+  RefCountedPtr<int> isolated(ref_counted_isolated, 3);
+  RefCountedPtr<int> packed(ref_counted_packed, 4);
+  RefCountedPtr<int> copy(packed);
+  CHECK(*isolated.get_data() == 3 && *copy.get_data() == 4);
+}
+
+/**
+ * @brief Narrow counters spill past their maximum, saturating counters pin
+ * the object, and both stay correct under concurrent copies.
+ */
+static void test_counter_policies() {
+  using Narrow = RefCountedCounter<std::uint8_t>;
+  using Short = RefCountedCounter<std::uint16_t>;
+  using Saturating = RefCountedCounter<std::uint8_t, true>;
+  {
+    RefCountedPtr<Tracked, Narrow> owner(1);
+    std::vector<RefCountedPtr<Tracked, Narrow>> copies;
+    for (int index = 0; index < 1000; ++index) {
+      copies.emplace_back(owner);
+    }
+    CHECK(owner.use_count() == 1001);
+    copies.clear();
+    CHECK(owner.use_count() == 1 && Tracked::live == 1);
+  }
+  CHECK(Tracked::live == 0);
+  {
+    RefCountedPtr<Tracked, Short> owner(2);
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < 4; ++thread) {
+      threads.emplace_back([&owner] {
+        std::vector<RefCountedPtr<Tracked, Short>> copies;
+        for (int index = 0; index < 40000; ++index) {
+          copies.emplace_back(owner);
+        }
+      });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    CHECK(owner.use_count() == 1);
+  }
+  CHECK(Tracked::live == 0);
+  {
+    // A saturated object is immortal by design; its storage is reclaimed
+    // with the process.
+    RefCountedPtr<int, Saturating> owner(3);
+    std::vector<RefCountedPtr<int, Saturating>> copies;
+    for (int index = 0; index < 300; ++index) {
+      copies.emplace_back(owner);
+    }
+    CHECK(owner.use_count() == 255);
+  }
+}
+
+/**
+ * @brief Handles are a single pointer and interoperate with RefCountedPtr.
+ */
+static void test_handle() {
+  static_assert(sizeof(RefCountedHandle<Tracked>) == sizeof(void *));
+  static_assert(sizeof(RefCountedPtr<Tracked>) == 2 * sizeof(void *));
+  {
+    RefCountedHandle<Tracked> handle(7);
+    RefCountedHandle<Tracked> copy(handle);
+    RefCountedHandle<Tracked> assigned;
+    assigned = copy;
+    RefCountedPtr<Tracked> pointer = handle.get_ptr();
+    CHECK(pointer.get_data() == handle.get_data() &&
+          assigned.get_data()->value == 7);
+    CHECK(pointer.use_count() == 4);
+    RefCountedHandle<Tracked> moved(std::move(copy));
+    CHECK(copy.get_data() == nullptr && pointer.use_count() == 4);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Lazily owned objects allocate their control block on first copy.
+ */
+static void test_lazy_control_block() {
+  {
+    RefCountedPtr<Tracked> lone(ref_counted_lazy, new Tracked(1));
+    CHECK(lone.use_count() == 1 && lone.is_unique());
+  }
+  CHECK(Tracked::live == 0);
+  {
+    RefCountedPtr<Tracked> first(ref_counted_lazy, new Tracked(2));
+    RefCountedPtr<Tracked> second(first);
+    RefCountedPtr<Tracked> third(ref_counted_lazy, new Tracked(3));
+    third = first;
+    CHECK(Tracked::live == 1 && first.use_count() == 3);
+    RefCountedPtr<Tracked> fourth(ref_counted_lazy, new Tracked(4));
+    third = std::move(fourth);
+    CHECK(Tracked::live == 2 && third.use_count() == 1);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Unique pointers promote to shared ones and come back when unique.
+ */
+static void test_unique_promotion() {
+  {
+    RefCountedUniquePtr<Tracked> unique(6);
+    Tracked *object = unique.get_data();
+    RefCountedPtr<Tracked> shared = unique.promote();
+    CHECK(unique.get_data() == nullptr && shared.get_data() == object);
+    RefCountedPtr<Tracked> copy(shared);
+    CHECK(shared.try_unique().get_data() == nullptr);
+    copy = RefCountedPtr<Tracked>();
+    RefCountedUniquePtr<Tracked> back = shared.try_unique();
+    CHECK(back.get_data() == object && shared.get_data() == nullptr);
+    RefCountedPtr<Tracked> again = back.promote();
+    CHECK(again.use_count() == 1);
+  }
+  CHECK(Tracked::live == 0);
+  {
+    RefCountedPtr<Tracked> lazy(ref_counted_lazy, new Tracked(1));
+    RefCountedUniquePtr<Tracked> unique = lazy.try_unique();
+    CHECK(unique.get_data() != nullptr);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Aliasing pointers keep the whole owner alive.
+ */
+static void test_aliasing() {
+  struct Message {
+    std::string name;
+    Tracked id;
+  };
+  RefCountedPtr<std::string> name;
+  {
+    RefCountedPtr<Message> message(Message{"hello", Tracked(3)});
+    name = RefCountedPtr<std::string>(message, &message.get_data()->name);
+    RefCountedPtr<Tracked> id(std::move(message), &message.get_data()->id);
+    CHECK(message.get_data() == nullptr && id.get_data()->value == 3);
+  }
+  CHECK(Tracked::live == 1 && *name.get_data() == "hello");
+  name = RefCountedPtr<std::string>();
+  CHECK(Tracked::live == 0);
+  RefCountedPtr<Message> empty;
+  int unrelated = 0;
+  RefCountedPtr<int> alias(empty, &unrelated);
+  CHECK(alias.get_data() == nullptr);
+}
+
+/**
+ * @brief Conversions and casts adjust the pointer and share the count.
+ */
+static void test_casts() {
+  RefCountedPtr<Derived> derived(ref_counted_packed);
+  RefCountedPtr<Right> right = derived;
+  CHECK(right.get_data()->right == 2 &&
+        static_cast<void *>(right.get_data()) !=
+            static_cast<void *>(derived.get_data()));
+  RefCountedPtr<Derived> back = dynamic_pointer_cast<Derived>(right);
+  CHECK(back.get_data() == derived.get_data());
+  RefCountedPtr<Left> left(std::move(derived));
+  CHECK(derived.get_data() == nullptr && left.use_count() == 3);
+  RefCountedPtr<Derived> down = static_pointer_cast<Derived>(left);
+  CHECK(down.get_data() == back.get_data());
+  RefCountedPtr<const Derived> constant = back;
+  RefCountedPtr<Derived> mutable_again = const_pointer_cast<Derived>(constant);
+  CHECK(mutable_again.get_data() == back.get_data());
+  RefCountedPtr<Right> plain(new Right);
+  RefCountedPtr<Derived> failed =
+      dynamic_pointer_cast<Derived>(std::move(plain));
+  CHECK(failed.get_data() == nullptr && plain.get_data() != nullptr);
+}
+
+/**
+ * @brief ref_from_this shares the control block of every owning path.
+ */
+static void test_ref_from_this() {
+  {
+    RefCountedPtr<Self> fused(1);
+    RefCountedPtr<Self> raw(new Self(2));
+    RefCountedPtr<Self> lazy(ref_counted_lazy, new Self(3));
+    RefCountedHandle<Self> handle(4);
+    CHECK(fused.get_data()->ref_from_this().get_data() == fused.get_data());
+    CHECK(raw.get_data()->ref_from_this().use_count() == 2);
+    CHECK(lazy.get_data()->ref_from_this().use_count() == 2);
+    CHECK(handle.get_data()->ref_from_this().get_data()->value == 4);
+    Self local(5);
+    Self copy(local);
+    CHECK(local.ref_from_this().get_data() == nullptr);
+    CHECK(copy.ref_from_this().get_data() == nullptr);
+    RefCountedUniquePtr<Self> unique = raw.try_unique();
+    CHECK(unique.get_data()->ref_from_this().get_data() == nullptr);
+    RefCountedPtr<Self> promoted = unique.promote();
+    CHECK(promoted.get_data()->ref_from_this().use_count() == 2);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief make_mutable clones only while the object is shared.
+ */
+static void test_make_mutable() {
+  RefCountedPtr<std::string> first(std::string("a"));
+  RefCountedPtr<std::string> second = first;
+  CHECK(first.use_count() == 2 && !first.is_unique());
+  std::string *original = first.get_data();
+  std::string *copy = first.make_mutable();
+  CHECK(copy != original && *copy == "a");
+  CHECK(first.is_unique() && second.is_unique());
+  CHECK(first.make_mutable() == copy);
+  RefCountedPtr<std::string> empty;
+  CHECK(empty.make_mutable() == nullptr && !empty.is_unique());
+
+  RefCountedPtr<Shape> shape = RefCountedPtr<Square>(Square());
+  RefCountedPtr<Shape> shared_shape = shape;
+  Shape *clone = shape.make_mutable();
+  CHECK(clone != shared_shape.get_data() && clone->get_corners() == 4);
+  RefCountedPtr<Right> right = RefCountedPtr<Derived>(Derived());
+  RefCountedPtr<Right> shared_right = right;
+  bool sliced = false;
+  try {
+    right.make_mutable();
+  } catch (std::bad_cast &) {
+    sliced = true;
+  }
+  CHECK(sliced && right.get_data() == shared_right.get_data());
+}
+
+/**
+ * @brief Runs the core RefCountedPtr tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_shared_ownership();
+  test_custom_deleter();
+  test_alignment();
+  test_layouts();
+  test_counter_policies();
+  test_handle();
+  test_lazy_control_block();
+  test_unique_promotion();
+  test_aliasing();
+  test_casts();
+  test_ref_from_this();
+  test_make_mutable();
+  return 0;
+}
@@ -0,0 +1,83 @@
+#include "RefCountedPtr.h"
+#include "TestSupport.h"
+#include <type_traits>
+#if defined(__unix__)
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Reads the borrowed object without taking ownership.
+ *
+ * @param borrow The borrowed object.
+ * @return int Its value.
+ */
+static int read_value(RefCountedRef<Tracked> borrow) {
+  return borrow.get_data()->value;
+}
+
+/**
+ * @brief Binding a borrow leaves the count alone; upgrading shares it.
+ */
+static void test_borrow() {
+  static_assert(
+      !std::is_constructible_v<RefCountedRef<Tracked>, RefCountedPtr<Tracked>>);
+  RefCountedPtr<Tracked> owner(new Tracked(5));
+  CHECK(read_value(owner) == 5 && owner.use_count() == 1);
+  RefCountedRef<Tracked> borrow = owner;
+  RefCountedRef<Tracked> copy = borrow;
+  copy = borrow;
+  RefCountedPtr<Tracked> upgraded = copy.get_ptr();
+  CHECK(upgraded.get_data() == owner.get_data() && owner.use_count() == 2);
+  RefCountedPtr<Tracked> lazy(ref_counted_lazy, new Tracked(6));
+  {
+    RefCountedRef<Tracked> lazy_borrow = lazy;
+    CHECK(lazy_borrow.get_ptr().get_data()->value == 6);
+  }
+  RefCountedRef<Tracked> empty;
+  CHECK(empty.get_data() == nullptr);
+}
+
+/**
+ * @brief Untracked borrows are not counted, so releasing the last owner
+ * before them goes unnoticed.
+ */
+static void test_untracked_borrow() {
+  RefCountedPtr<Tracked> *owner = new RefCountedPtr<Tracked>(new Tracked);
+  RefCountedRef<Tracked, RefCountedDefaultCounter, false> borrow = *owner;
+  delete owner;
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Releasing the last owner while a tracked borrow is alive aborts,
+ * whatever REFCOUNTEDPTR_TRACK_BORROWS defaults to.
+ */
+static void test_dangling_borrow_aborts() {
+#if defined(__unix__)
+  pid_t child = fork();
+  if (child == 0) {
+    close(STDERR_FILENO);
+    RefCountedPtr<Tracked> *owner = new RefCountedPtr<Tracked>(new Tracked);
+    RefCountedRef<Tracked, RefCountedDefaultCounter, true> borrow = *owner;
+    delete owner;
+    _exit(0);
+  }
+  int status = 0;
+  waitpid(child, &status, 0);
+  CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+#endif
+}
+
+/**
+ * @brief Runs the borrow tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_borrow();
+  test_untracked_borrow();
+  test_dangling_borrow_aborts();
+  return 0;
+}
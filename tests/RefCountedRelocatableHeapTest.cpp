@@ -0,0 +1,165 @@
+#include "RefCountedRelocatableHeap.h"
+#include "TestSupport.h"
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using StringHeap = RefCountedRelocatableHeap<std::string>;
+
+/**
+ * @brief Relocatable object whose constructor can be told to throw.
+ */
+struct Picky : Tracked {
+  /**
+   * @brief Constructs an object or throws.
+   *
+   * @param value The payload; negative values throw.
+   */
+  Picky(int value) : Tracked(value) {
+    if (value < 0) {
+      throw std::runtime_error("rejected");
+    }
+  }
+
+  /**
+   * @brief Move constructor required for relocation.
+   *
+   * @param other The object to move from.
+   */
+  Picky(Picky &&other) noexcept : Tracked(other) {}
+};
+
+/**
+ * @brief Graph node whose constructor creates its child in the same heap.
+ */
+struct Chain : Tracked {
+  RefCountedRelocatableHeap<Chain>::Handle child; ///< Next node, if any.
+
+  /**
+   * @brief Constructs a node and, below the given depth, its children.
+   *
+   * @param heap The heap holding the node.
+   * @param depth Number of nodes still to create below this one.
+   */
+  Chain(RefCountedRelocatableHeap<Chain> &heap, int depth) : Tracked(depth) {
+    if (depth > 0) {
+      child = heap.create(heap, depth - 1);
+    }
+  }
+
+  /**
+   * @brief Move constructor required for relocation.
+   *
+   * @param other The node to move from.
+   */
+  Chain(Chain &&other) noexcept
+      : Tracked(other), child(std::move(other.child)) {}
+};
+
+/**
+ * @brief Compaction waits for pins, then returns emptied pages and keeps
+ * every live object reachable.
+ */
+static void test_compaction() {
+  StringHeap heap(4);
+  std::vector<StringHeap::Handle> handles;
+  for (int index = 0; index < 16; ++index) {
+    handles.push_back(heap.create(std::string(40, 'a' + index)));
+  }
+  CHECK(heap.get_reserved_bytes() == 16 * sizeof(std::string));
+  for (int index = 0; index < 16; ++index) {
+    if (index % 4 != 0) {
+      handles[index] = StringHeap::Handle();
+    }
+  }
+  CHECK(heap.size() == 4);
+  {
+    StringHeap::Pin pin = handles[12].pin();
+    CHECK(heap.compact() == 0);
+    CHECK(*pin.get_data() == std::string(40, 'm'));
+  }
+  CHECK(heap.compact() == 12 * sizeof(std::string));
+  for (int index = 0; index < 16; index += 4) {
+    StringHeap::Pin pin = handles[index].pin();
+    CHECK(*pin.get_data() == std::string(40, 'a' + index));
+  }
+  StringHeap::Handle fresh = heap.create("new");
+  CHECK(heap.size() == 5 && *fresh.pin().get_data() == "new");
+}
+
+/**
+ * @brief A pin keeps its object alive after the last handle is released.
+ */
+static void test_pin_owns() {
+  StringHeap heap(4);
+  StringHeap::Handle handle = heap.create("pinned");
+  StringHeap::Pin pin = handle.pin();
+  handle = StringHeap::Handle();
+  CHECK(heap.size() == 1 && *pin.get_data() == "pinned");
+  {
+    StringHeap::Pin moved(std::move(pin));
+    CHECK(pin.get_data() == nullptr);
+  }
+  CHECK(heap.size() == 0);
+}
+
+/**
+ * @brief Zero-sized pages are rejected, and a throwing constructor leaves
+ * the heap unchanged.
+ */
+static void test_errors() {
+  bool threw = false;
+  try {
+    StringHeap empty(0);
+  } catch (std::invalid_argument &) {
+    threw = true;
+  }
+  CHECK(threw);
+  {
+    RefCountedRelocatableHeap<Picky> heap(2);
+    RefCountedRelocatableHeap<Picky>::Handle kept = heap.create(1);
+    threw = false;
+    try {
+      heap.create(-1);
+    } catch (std::runtime_error &) {
+      threw = true;
+    }
+    CHECK(threw && heap.size() == 1 && Tracked::live == 1);
+    RefCountedRelocatableHeap<Picky>::Handle next = heap.create(2);
+    CHECK(heap.size() == 2 && next.pin().get_data()->value == 2);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief A constructor that creates objects in the same heap gets its own
+ * slots and handle entries.
+ */
+static void test_nested_create() {
+  {
+    RefCountedRelocatableHeap<Chain> heap(2);
+    RefCountedRelocatableHeap<Chain>::Handle head = heap.create(heap, 4);
+    CHECK(heap.size() == 5 && Tracked::live == 5);
+    RefCountedRelocatableHeap<Chain>::Handle node = head;
+    for (int depth = 4; depth >= 0; --depth) {
+      RefCountedRelocatableHeap<Chain>::Pin pin = node.pin();
+      CHECK(pin.get_data()->value == depth);
+      RefCountedRelocatableHeap<Chain>::Handle next = pin.get_data()->child;
+      node = std::move(next);
+    }
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Runs the relocatable heap tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_compaction();
+  test_pin_owns();
+  test_errors();
+  test_nested_create();
+  return 0;
+}
@@ -0,0 +1,135 @@
+#include "RefCountedPtr.h"
+#include "TestSupport.h"
+#include <memory>
+
+/**
+ * @brief Objects made by RefCountedPtr convert to std::shared_ptr and back.
+ */
+static void test_round_trip_from_ref_counted() {
+  {
+    RefCountedPtr<Tracked> pointer(5);
+    std::shared_ptr<Tracked> shared = pointer.to_shared();
+    CHECK(shared.get() == pointer.get_data() && shared->value == 5);
+    CHECK(pointer.use_count() == 2);
+    RefCountedPtr<Tracked> back = RefCountedPtr<Tracked>::from_shared(shared);
+    CHECK(back.get_data() == pointer.get_data() && pointer.use_count() == 3);
+    pointer = RefCountedPtr<Tracked>();
+    back = RefCountedPtr<Tracked>();
+    CHECK(Tracked::live == 1);
+    shared.reset();
+    CHECK(Tracked::live == 0);
+  }
+}
+
+/**
+ * @brief Objects made by std::shared_ptr convert to RefCountedPtr and back.
+ */
+static void test_round_trip_from_shared() {
+  std::shared_ptr<Tracked> shared = std::make_shared<Tracked>(7);
+  RefCountedPtr<Tracked> pointer = RefCountedPtr<Tracked>::from_shared(shared);
+  CHECK(pointer.get_data() == shared.get() && shared.use_count() == 2);
+  std::shared_ptr<Tracked> again = pointer.to_shared();
+  CHECK(again.get() == shared.get() && shared.use_count() == 3);
+  CHECK(std::get_deleter<RefCountedSharedDeleter<>>(again) == nullptr);
+  shared.reset();
+  again.reset();
+  CHECK(Tracked::live == 1);
+  pointer = RefCountedPtr<Tracked>();
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Const objects and empty pointers convert as well.
+ */
+static void test_const_and_empty() {
+  RefCountedPtr<const Tracked> constant(3);
+  std::shared_ptr<const Tracked> shared = constant.to_shared();
+  CHECK(shared->value == 3);
+  RefCountedPtr<const Tracked> empty =
+      RefCountedPtr<const Tracked>::from_shared(nullptr);
+  CHECK(empty.get_data() == nullptr);
+  RefCountedPtr<Tracked> none;
+  CHECK(none.to_shared() == nullptr);
+}
+
+/**
+ * @brief A lazily owned object gets one bridge block, and every conversion
+ * after that shares its owner.
+ */
+static void test_lazy_bridge() {
+  {
+    RefCountedPtr<Tracked> pointer(ref_counted_lazy, new Tracked(4));
+    std::shared_ptr<Tracked> first = pointer.to_shared();
+    CHECK(std::get_deleter<RefCountedBridgeBlock<Tracked>>(first) != nullptr);
+    CHECK(pointer.use_count() == 1);
+    RefCountedPtr<Tracked> copy(pointer);
+    std::shared_ptr<Tracked> second = copy.to_shared();
+    CHECK(!first.owner_before(second) && !second.owner_before(first));
+    CHECK(first.use_count() == 3);
+    RefCountedPtr<Tracked> back = RefCountedPtr<Tracked>::from_shared(second);
+    CHECK(back.get_data() == pointer.get_data() && pointer.use_count() == 3);
+    pointer = RefCountedPtr<Tracked>();
+    copy = RefCountedPtr<Tracked>();
+    back = RefCountedPtr<Tracked>();
+    CHECK(Tracked::live == 1 && first.use_count() == 2);
+    RefCountedPtr<Tracked> revived = RefCountedPtr<Tracked>::from_shared(first);
+    first.reset();
+    second.reset();
+    CHECK(Tracked::live == 1 && revived.get_data()->value == 4);
+  }
+  CHECK(Tracked::live == 0);
+  {
+    RefCountedPtr<Tracked> pointer(ref_counted_lazy, new Tracked(6));
+    pointer.to_shared();
+    CHECK(Tracked::live == 1);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief A std::shared_ptr still sharing the object keeps a pointer with a
+ * count of 1 from being unique.
+ */
+static void test_external_owners() {
+  {
+    std::shared_ptr<Tracked> shared = std::make_shared<Tracked>(1);
+    RefCountedPtr<Tracked> pointer =
+        RefCountedPtr<Tracked>::from_shared(shared);
+    CHECK(pointer.use_count() == 1 && !pointer.is_unique());
+    CHECK(pointer.try_unique().get_data() == nullptr);
+    CHECK(pointer.get_data() == shared.get());
+    pointer.make_mutable()->value = 42;
+    CHECK(pointer.get_data() != shared.get() && shared->value == 1);
+    CHECK(pointer.is_unique() && pointer.get_data()->value == 42);
+    RefCountedPtr<Tracked> adopted =
+        RefCountedPtr<Tracked>::from_shared(std::make_shared<Tracked>(2));
+    CHECK(adopted.is_unique());
+    adopted.wait_until_released();
+    CHECK(Tracked::live == 2);
+  }
+  CHECK(Tracked::live == 0);
+  {
+    RefCountedPtr<Tracked> pointer(ref_counted_lazy, new Tracked(3));
+    std::shared_ptr<Tracked> shared = pointer.to_shared();
+    CHECK(pointer.use_count() == 1 && !pointer.is_unique());
+    shared.reset();
+    CHECK(pointer.is_unique());
+    CHECK(pointer.try_unique().get_data() != nullptr);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Runs the std::shared_ptr interop tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_round_trip_from_ref_counted();
+  test_round_trip_from_shared();
+  test_const_and_empty();
+  test_lazy_bridge();
+  test_external_owners();
+  CHECK(Tracked::live == 0);
+  return 0;
+}
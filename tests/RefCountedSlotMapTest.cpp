@@ -0,0 +1,114 @@
+#include "RefCountedSlotMap.h"
+#include "TestSupport.h"
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Node whose constructor inserts its children into the same map, and
+ * which can be told to throw.
+ */
+struct Tree : Tracked {
+  std::vector<RefCountedSlotMap<Tree>::Handle> children; ///< Child nodes.
+
+  /**
+   * @brief Constructs a node and, below the given depth, two children.
+   *
+   * @param map The map holding the node.
+   * @param depth Levels still to create below this one; negative throws.
+   */
+  Tree(RefCountedSlotMap<Tree> &map, int depth) : Tracked(depth) {
+    if (depth < 0) {
+      throw std::runtime_error("rejected");
+    }
+    if (depth > 0) {
+      children.push_back(map.insert(map, depth - 1));
+      children.push_back(map.insert(map, depth - 1));
+    }
+  }
+
+  /**
+   * @brief Move constructor used when the node is stored.
+   *
+   * @param other The node to move from.
+   */
+  Tree(Tree &&other) noexcept
+      : Tracked(other), children(std::move(other.children)) {}
+};
+
+/**
+ * @brief Handles share objects and keys go stale once the object is gone.
+ */
+static void test_handles_and_keys() {
+  RefCountedSlotMap<std::string> map;
+  RefCountedSlotMap<std::string>::Key key;
+  {
+    RefCountedSlotMap<std::string>::Handle handle = map.insert("hello");
+    key = handle.get_key();
+    RefCountedSlotMap<std::string>::Handle copy = handle;
+    RefCountedSlotMap<std::string>::Handle assigned;
+    assigned = copy;
+    CHECK(map.get_data(key)->size() == 5 && map.size() == 1);
+  }
+  CHECK(!map.contains(key) && map.get_data(key) == nullptr);
+  CHECK(map.lock(key).get_data() == nullptr);
+  RefCountedSlotMap<std::string>::Handle reused = map.insert(3, 'a');
+  CHECK(reused.get_key().index == key.index);
+  CHECK(reused.get_key().generation == key.generation + 1);
+}
+
+/**
+ * @brief lock upgrades live keys and for_each visits every live object.
+ */
+static void test_lock_and_iteration() {
+  RefCountedSlotMap<std::string> map;
+  RefCountedSlotMap<std::string>::Handle first = map.insert("a");
+  RefCountedSlotMap<std::string>::Handle second = map.insert("b");
+  RefCountedSlotMap<std::string>::Handle locked = map.lock(second.get_key());
+  CHECK(locked.get_data() == second.get_data());
+  std::string all;
+  map.for_each([&all](std::string &value) { all += value; });
+  CHECK(all == "ab");
+  std::vector<RefCountedSlotMap<std::string>::Handle> many;
+  for (int index = 0; index < 50; ++index) {
+    many.push_back(map.insert(std::to_string(index)));
+  }
+  CHECK(map.size() == 52);
+}
+
+/**
+ * @brief Constructors that insert into the same map get their own slots,
+ * and a throwing constructor gives its slot back.
+ */
+static void test_nested_insert() {
+  {
+    RefCountedSlotMap<Tree> map;
+    RefCountedSlotMap<Tree>::Handle root = map.insert(map, 4);
+    CHECK(map.size() == 31 && Tracked::live == 31);
+    int sum = 0;
+    map.for_each([&sum](Tree &node) { sum += node.value; });
+    CHECK(sum == 4 + 2 * 3 + 4 * 2 + 8 * 1);
+    bool threw = false;
+    try {
+      map.insert(map, -1);
+    } catch (std::runtime_error &) {
+      threw = true;
+    }
+    CHECK(threw && map.size() == 31 && Tracked::live == 31);
+    RefCountedSlotMap<Tree>::Handle leaf = map.insert(map, 0);
+    CHECK(map.size() == 32 && leaf.get_data()->value == 0);
+  }
+  CHECK(Tracked::live == 0);
+}
+
+/**
+ * @brief Runs the slot map tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_handles_and_keys();
+  test_lock_and_iteration();
+  test_nested_insert();
+  return 0;
+}
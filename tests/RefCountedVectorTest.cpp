@@ -0,0 +1,76 @@
+#include "CompactRefCountedPtr.h"
+#include "RefCountedVector.h"
+#include "TestSupport.h"
+#include <string>
+#include <utility>
+
+static_assert(ref_counted_is_trivially_relocatable_v<RefCountedPtr<int>>);
+static_assert(ref_counted_is_trivially_relocatable_v<RefCountedPtr<int[]>>);
+static_assert(ref_counted_is_trivially_relocatable_v<RefCountedHandle<int>>);
+static_assert(
+    ref_counted_is_trivially_relocatable_v<CompactRefCountedPtr<int>>);
+static_assert(ref_counted_is_trivially_relocatable_v<
+              std::pair<int, RefCountedPtr<int>>>);
+static_assert(!ref_counted_is_trivially_relocatable_v<std::string>);
+static_assert(sizeof(RefCountedVector<int>) == 3 * sizeof(void *));
+
+/**
+ * @brief Growing, inserting and erasing relocate the pointers without
+ * changing their counts.
+ */
+static void test_pointer_elements() {
+  RefCountedVector<RefCountedPtr<std::string>> pointers;
+  RefCountedPtr<std::string> kept(std::string("keep"));
+  for (int index = 0; index < 1000; ++index) {
+    pointers.emplace_back(kept);
+  }
+  for (int index = 0; index < 1000; ++index) {
+    pointers.emplace_back(std::to_string(index));
+  }
+  pointers.emplace_back(pointers[0]);
+  CHECK(pointers.size() == 2001 && *pointers[2000].get_data() == "keep");
+  CHECK(kept.use_count() == 1002);
+  pointers.erase(10, 1000);
+  CHECK(pointers.size() == 1011 && *pointers[10].get_data() == "0");
+  CHECK(kept.use_count() == 12);
+  pointers.emplace(5, std::string("middle"));
+  CHECK(*pointers[5].get_data() == "middle" && *pointers[11].get_data() == "0");
+  RefCountedVector<RefCountedPtr<std::string>> copy = pointers;
+  CHECK(copy.size() == pointers.size() && kept.use_count() == 23);
+  RefCountedVector<RefCountedPtr<std::string>> moved = std::move(copy);
+  CHECK(copy.size() == 0 && moved.size() == 1012);
+}
+
+/**
+ * @brief Small vectors keep elements inline until the capacity is exceeded.
+ */
+static void test_inline_storage() {
+  RefCountedVector<std::string, 4> strings;
+  strings.emplace_back("a");
+  strings.emplace_back("b");
+  strings.emplace(0, "z");
+  CHECK(strings.get_capacity() == 4 && strings[0] == "z");
+  strings.emplace_back("c");
+  strings.emplace_back(std::string(50, 'x'));
+  CHECK(strings.size() == 5 && strings[4] == std::string(50, 'x'));
+  CHECK(strings[1] == "a");
+  RefCountedVector<std::string, 4> moved = std::move(strings);
+  CHECK(moved.size() == 5 && strings.size() == 0);
+  RefCountedVector<std::string, 4> small;
+  small.emplace_back("q");
+  RefCountedVector<std::string, 4> moved_inline = std::move(small);
+  CHECK(moved_inline[0] == "q");
+  moved_inline = moved;
+  CHECK(moved_inline.size() == 5);
+}
+
+/**
+ * @brief Runs the relocating vector tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_pointer_elements();
+  test_inline_storage();
+  return 0;
+}
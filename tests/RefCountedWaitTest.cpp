@@ -0,0 +1,117 @@
+#include "RefCountedPtr.h"
+#include "TestSupport.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Object counting its destructions across threads.
+ */
+struct Counted {
+  static inline std::atomic<int> destroyed{0}; ///< Destructions so far.
+
+  /**
+   * @brief Counts the destruction.
+   */
+  ~Counted() { ++destroyed; }
+};
+
+/**
+ * @brief wait_until_released returns once every reader is done and destroys
+ * the object on the waiting thread.
+ */
+static void test_wait_until_released() {
+  for (int round = 0; round < 100; ++round) {
+    RefCountedPtr<Counted> owner(new Counted);
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < 4; ++reader) {
+      readers.emplace_back([copy = RefCountedPtr<Counted>(owner)]() mutable {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        copy = RefCountedPtr<Counted>();
+      });
+    }
+    owner.wait_until_released();
+    CHECK(owner.get_data() == nullptr && Counted::destroyed == round + 1);
+    for (std::thread &reader : readers) {
+      reader.join();
+    }
+  }
+}
+
+/**
+ * @brief Empty and lazily owned pointers never block.
+ */
+static void test_trivial_waits() {
+  RefCountedPtr<Counted> empty;
+  empty.wait_until_unique();
+  empty.wait_until_released();
+  RefCountedPtr<Counted> lazy(ref_counted_lazy, new Counted);
+  lazy.wait_until_unique();
+}
+
+/**
+ * @brief Releasing an immortal object returns at once and leaves it alive.
+ */
+static void test_immortal_release() {
+  RefCountedStaticBlock<Counted> block;
+  int destroyed = Counted::destroyed;
+  RefCountedPtr<Counted> first(block);
+  RefCountedPtr<Counted> second(block);
+  first.wait_until_released();
+  CHECK(first.get_data() == nullptr && Counted::destroyed == destroyed);
+  CHECK(second.get_data() == block.get_data());
+}
+
+/**
+ * @brief Releases through a handle wake a waiting pointer.
+ */
+static void test_handle_release_wakes() {
+  RefCountedHandle<Counted> handle(Counted{});
+  RefCountedPtr<Counted> pointer = handle.get_ptr();
+  CHECK(pointer.use_count() == 2);
+  std::thread releaser([&handle] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    handle = RefCountedHandle<Counted>();
+  });
+  pointer.wait_until_unique();
+  CHECK(pointer.is_unique());
+  releaser.join();
+}
+
+/**
+ * @brief Releasing an array wakes an aliasing pointer waiting on one of its
+ * elements, whether the array is destroyed or reassigned.
+ */
+static void test_array_release_wakes() {
+  for (int round = 0; round < 2; ++round) {
+    RefCountedPtr<float[]> array = make_ref_counted_array<float>(8, 1.5f);
+    RefCountedPtr<float> element(array, &array[3]);
+    std::thread releaser([&array, round] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      if (round == 0) {
+        RefCountedPtr<float[]> empty;
+        array = empty;
+      } else {
+        RefCountedPtr<float[]> dropped(std::move(array));
+      }
+    });
+    element.wait_until_unique();
+    CHECK(element.is_unique() && *element.get_data() == 1.5f);
+    releaser.join();
+  }
+}
+
+/**
+ * @brief Runs the waiting tests.
+ *
+ * @return int Exit status.
+ */
+int main() {
+  test_wait_until_released();
+  test_trivial_waits();
+  test_immortal_release();
+  test_handle_release_wakes();
+  test_array_release_wakes();
+  return 0;
+}
@@ -0,0 +1,55 @@
+#ifndef REFCOUNTEDPTR_TEST_SUPPORT_HEADER
+#define REFCOUNTEDPTR_TEST_SUPPORT_HEADER
+
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * @brief Reports a failed check and aborts the test.
+ *
+ * @param condition The source text of the failed condition.
+ * @param file The file containing the check.
+ * @param line The line of the check.
+ */
+[[noreturn]] inline void ref_counted_test_fail(const char *condition,
+                                               const char *file, int line) {
+  std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+  std::abort();
+}
+
+/**
+ * @brief Aborts the test unless the condition holds; unlike assert, it stays
+ * active when NDEBUG is defined.
+ */
+#define CHECK(condition)                                                       \
+  ((condition) ? static_cast<void>(0)                                         \
+               : ref_counted_test_fail(#condition, __FILE__, __LINE__))
+
+/**
+ * @brief Object counting how many instances are alive.
+ */
+struct Tracked {
+  static inline int live = 0; ///< Number of live instances.
+  int value;                  ///< Payload checked by the tests.
+
+  /**
+   * @brief Constructs an instance holding the given value.
+   *
+   * @param value The payload.
+   */
+  Tracked(int value = 0) : value(value) { ++live; }
+
+  /**
+   * @brief Copy constructor counting the new instance.
+   *
+   * @param other The instance to copy.
+   */
+  Tracked(const Tracked &other) : value(other.value) { ++live; }
+
+  /**
+   * @brief Destructor uncounting the instance.
+   */
+  ~Tracked() { --live; }
+};
+
+#endif
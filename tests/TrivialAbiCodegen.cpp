@@ -0,0 +1,25 @@
+#include "RefCountedPtr.h"
+
+/**
+ * @brief Passes a handle through by value.
+ *
+ * With [[clang::trivial_abi]] the handle arrives and leaves in a register,
+ * so the function body must not touch memory. CheckTrivialAbi.cmake inspects
+ * the generated assembly.
+ *
+ * @param handle The handle to return.
+ * @return RefCountedHandle<int> The same handle.
+ */
+extern "C" RefCountedHandle<int> forward_handle(RefCountedHandle<int> handle) {
+  return handle;
+}
+
+/**
+ * @brief Passes a pointer through by value; see forward_handle.
+ *
+ * @param pointer The pointer to return.
+ * @return RefCountedPtr<int> The same pointer.
+ */
+extern "C" RefCountedPtr<int> forward_pointer(RefCountedPtr<int> pointer) {
+  return pointer;
+}